@@ -0,0 +1,50 @@
+/*
+ * Micro benchmark for the PRIO scheduler's multi-level queue.
+ * Cycles a fixed set of ready processes through AddProcess / GetNextProcess
+ * the way the simulation does (decay on every dispatch, so processes drift
+ * down the levels and eventually into the expired queue).
+ *
+ * usage: bench_prio [processes] [rounds]
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include "sched.h"
+
+using namespace std;
+
+bool SHOW_SCHED_READY_QUEUE = false;
+bool SHOW_EVENT_QUEUE = false;
+bool SHOW_PRIO_PREEMPT = false;
+
+int main(int argc, char *argv[]) {
+	int nproc = argc > 1 ? atoi(argv[1]) : 1000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 1000000;
+	int maxprios[] = {4, 8, 16, 40, 64, 100, 140};
+
+	cout << "maxprio   ns/op" << endl;
+	for (int maxprio: maxprios) {
+		PROCESS_TABLE = ProcessTable();
+		for (int pid = 0; pid < nproc; pid++) {
+			PROCESS_TABLE.Add(0, 100, 10, 10, 1 + pid % maxprio);
+		}
+
+		PRIO_scheduler sched(2, maxprio);
+		for (int pid = 0; pid < nproc; pid++) {
+			sched.AddProcess(pid);
+		}
+
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < rounds; i++) {
+			int pid = sched.GetNextProcess();
+			PROCESS_TABLE.dynamic_prio[pid] -= 1;
+			sched.AddProcess(pid);
+		}
+		auto end = chrono::steady_clock::now();
+
+		double ns = chrono::duration<double, nano>(end - start).count() / rounds;
+		cout << setw(7) << maxprio << " " << setw(7) << fixed << setprecision(1) << ns << endl;
+	}
+	return 0;
+}
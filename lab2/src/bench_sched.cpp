@@ -0,0 +1,287 @@
+/*
+ * Scheduler benchmark on synthetic workloads.
+ * Generates an input file (and a random file) from the options below, runs
+ * every requested scheduler on it with ./sched -l -x and prints a table of
+ * simulator speed, peak RSS and the SUM numbers. Input lines are
+ * "<at> <tc> <cb> <io>", sorted by arrival time.
+ *
+ * usage: bench_sched [-g] [-n count] [-a arrivals] [-t dist] [-c dist]
+ *                    [-i dist] [-p maxprio] [-q quantum] [-s scheds]
+ *                    [-S seed] [-B sched binary]
+ *   -g  only write the workload to stdout
+ *   -n  number of processes, 10 .. 10000000 (default 10000)
+ *   -a  poisson:<mean gap> or bursty:<mean gap>:<burst size>
+ *       (default poisson:250); a burst arrives at one time stamp
+ *   -t  total cpu time per process (default exp:200)
+ *   -c  max cpu burst per process (default uni:1:40)
+ *   -i  max io burst per process (default uni:1:40)
+ *       a dist is fix:<v>, uni:<lo>:<hi> or exp:<mean>, all at least 1
+ *   -p  maxprio, the priority spread of P and E (default 4)
+ *   -q  quantum of R, P and E (default 10)
+ *   -s  schedulers to run (default FLSRPE)
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+const int BENCH_MIN_PROCESSES = 10;
+const int BENCH_MAX_PROCESSES = 10000000;
+const int BENCH_RANDOM_NUMBERS = 100000;
+
+struct Distribution {
+	char kind = 'f'; // fix, uni, exp
+	double a = 1;
+	double b = 1;
+	bool Parse(string spec);
+	int Draw(mt19937_64 &gen);
+};
+
+bool Distribution::Parse(string spec) {
+	string name = spec.substr(0, spec.find(':'));
+	istringstream args(spec.find(':') == string::npos ? "" : spec.substr(spec.find(':') + 1));
+	char sep;
+	if (name == "fix" && args >> a) {
+		kind = 'f';
+	} else if (name == "uni" && args >> a >> sep >> b && a <= b) {
+		kind = 'u';
+	} else if (name == "exp" && args >> a && a > 0) {
+		kind = 'e';
+	} else {
+		return false;
+	}
+	return a >= 1;
+}
+
+int Distribution::Draw(mt19937_64 &gen) {
+	double v = a;
+	if (kind == 'u') {
+		v = uniform_int_distribution<long>(a, b)(gen);
+	} else if (kind == 'e') {
+		v = ceil(exponential_distribution<double>(1 / a)(gen));
+	}
+	return max(1.0, min(v, 1e9));
+}
+
+struct Workload {
+	int count = 10000;
+	bool bursty = false;
+	double mean_gap = 250;
+	int burst_size = 1;
+	Distribution total_cpu, cpu_burst, io_burst;
+	unsigned long seed = 1;
+	bool ParseArrivals(string spec);
+	void Write(ostream &out);
+};
+
+bool Workload::ParseArrivals(string spec) {
+	char sep;
+	string name = spec.substr(0, spec.find(':'));
+	istringstream args(spec.find(':') == string::npos ? "" : spec.substr(spec.find(':') + 1));
+	if (name == "poisson" && args >> mean_gap && mean_gap > 0) {
+		bursty = false;
+		burst_size = 1;
+		return true;
+	}
+	if (name == "bursty" && args >> mean_gap >> sep >> burst_size && mean_gap > 0 && burst_size >= 1) {
+		bursty = true;
+		return true;
+	}
+	return false;
+}
+
+// exponential gaps between bursts keep the mean gap per process
+void Workload::Write(ostream &out) {
+	mt19937_64 gen(seed);
+	exponential_distribution<double> gap(1 / (mean_gap * burst_size));
+	double now = 0;
+	for (int i = 0; i < count; i++) {
+		if (i % burst_size == 0 && i > 0) {
+			now += gap(gen);
+		}
+		out << (long)now << " " << total_cpu.Draw(gen) << " "
+			<< cpu_burst.Draw(gen) << " " << io_burst.Draw(gen) << '\n';
+	}
+}
+
+void WriteRandomFile(string name, unsigned long seed) {
+	mt19937_64 gen(seed ^ 0x5eed);
+	ofstream out(name);
+	out << BENCH_RANDOM_NUMBERS << '\n';
+	for (int i = 0; i < BENCH_RANDOM_NUMBERS; i++) {
+		out << (gen() >> 33) << '\n';
+	}
+}
+
+struct BenchResult {
+	bool ok = false;
+	double seconds = 0;
+	long peak_rss_kb = 0;
+	long events = 0;
+	string sum; // the SUM numbers
+	long p99_turnaround = 0;
+};
+
+// run sched with the given scheduler spec, reading its report from a pipe
+BenchResult RunSched(string binary, string spec, string infile, string rfile) {
+	BenchResult res;
+	int pipefd[2];
+	if (pipe(pipefd) != 0) {
+		return res;
+	}
+	auto start = chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (pid == 0) {
+		dup2(pipefd[1], STDOUT_FILENO);
+		close(pipefd[0]);
+		close(pipefd[1]);
+		string sopt = "-s" + spec;
+		execl(binary.c_str(), binary.c_str(), "-l", "-x", sopt.c_str(), infile.c_str(), rfile.c_str(), (char*)nullptr);
+		_exit(127);
+	}
+	close(pipefd[1]);
+
+	// only the summary lines are kept, the per-process lines are skipped
+	FILE *in = fdopen(pipefd[0], "r");
+	char line[4096];
+	while (fgets(line, sizeof(line), in)) {
+		string s(line);
+		if (s.compare(0, 5, "SUM: ") == 0) {
+			res.sum = s.substr(5, s.size() - 6);
+		} else if (s.compare(0, 8, "EVENTS: ") == 0) {
+			res.events = atol(s.c_str() + 8);
+		} else if (s.compare(0, 12, "TURNAROUND: ") == 0) {
+			long count, p50, p90, p99;
+			istringstream(s.substr(12)) >> count >> p50 >> p90 >> p99;
+			res.p99_turnaround = p99;
+		}
+	}
+	fclose(in);
+
+	int status = 0;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	res.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	res.peak_rss_kb = usage.ru_maxrss;
+	res.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && !res.sum.empty();
+	return res;
+}
+
+int main(int argc, char *argv[]) {
+	Workload wl;
+	wl.total_cpu.Parse("exp:200");
+	wl.cpu_burst.Parse("uni:1:40");
+	wl.io_burst.Parse("uni:1:40");
+	bool generate_only = false;
+	int maxprio = 4;
+	int quantum = 10;
+	string scheds = "FLSRPE";
+	string binary = "./sched";
+
+	char c;
+	opterr = 0;
+	while ((c = getopt(argc, argv, "gn:a:t:c:i:p:q:s:S:B:")) != -1) {
+		bool ok = true;
+		switch (c) {
+			case 'g':
+				generate_only = true;
+				break;
+			case 'n':
+				wl.count = atoi(optarg);
+				ok = wl.count >= BENCH_MIN_PROCESSES && wl.count <= BENCH_MAX_PROCESSES;
+				break;
+			case 'a':
+				ok = wl.ParseArrivals(optarg);
+				break;
+			case 't':
+				ok = wl.total_cpu.Parse(optarg);
+				break;
+			case 'c':
+				ok = wl.cpu_burst.Parse(optarg);
+				break;
+			case 'i':
+				ok = wl.io_burst.Parse(optarg);
+				break;
+			case 'p':
+				maxprio = atoi(optarg);
+				ok = maxprio >= 1;
+				break;
+			case 'q':
+				quantum = atoi(optarg);
+				ok = quantum >= 1;
+				break;
+			case 's':
+				scheds = optarg;
+				break;
+			case 'S':
+				wl.seed = strtoul(optarg, nullptr, 10);
+				break;
+			case 'B':
+				binary = optarg;
+				break;
+			default:
+				cerr << "invalid option -- \'" << char(optopt) << "\'\n";
+				return 1;
+		}
+		if (!ok) {
+			cerr << "Invalid argument <" << optarg << "> for -" << c << endl;
+			return 1;
+		}
+	}
+
+	if (generate_only) {
+		wl.Write(cout);
+		return 0;
+	}
+
+	string dir = "/tmp/bench_sched." + to_string(getpid());
+	string infile = dir + ".in";
+	string rfile = dir + ".rand";
+	{
+		ofstream out(infile);
+		wl.Write(out);
+	}
+	WriteRandomFile(rfile, wl.seed);
+
+	cout << "processes " << wl.count << ", seed " << wl.seed << endl;
+	// sched | events | seconds | Mevents/s | peak RSS MB | p99 turnaround | SUM numbers
+	cout << left << setw(10) << "sched" << right
+		 << setw(12) << "events" << setw(9) << "sec" << setw(10) << "Mev/s"
+		 << setw(9) << "RSS MB" << setw(11) << "p99 TT" << "  SUM" << endl;
+	int failures = 0;
+	for (char s: scheds) {
+		string spec(1, s);
+		if (s == 'R') {
+			spec += to_string(quantum);
+		} else if (s == 'P' || s == 'E') {
+			spec += to_string(quantum) + ":" + to_string(maxprio);
+		}
+		BenchResult res = RunSched(binary, spec, infile, rfile);
+		if (!res.ok) {
+			cout << left << setw(10) << spec << right << "  failed" << endl;
+			failures++;
+			continue;
+		}
+		cout << left << setw(10) << spec << right
+			 << setw(12) << res.events
+			 << setw(9) << fixed << setprecision(2) << res.seconds
+			 << setw(10) << fixed << setprecision(2) << res.events / res.seconds / 1e6
+			 << setw(9) << fixed << setprecision(1) << res.peak_rss_kb / 1024.0
+			 << setw(11) << res.p99_turnaround
+			 << "  " << res.sum << endl;
+	}
+	unlink(infile.c_str());
+	unlink(rfile.c_str());
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# End-to-end checks of the simulator (make check): runs ./sched on a generated
+# workload and checks properties of the output that must always hold.
+#
+# usage: check.sh [<sched binary>]
+
+SCHED=${1:-./sched}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+FAILED=0
+
+fail() {
+	echo "FAIL: $*"
+	FAILED=1
+}
+
+# 200 processes: <at> <tc> <cb> <io>, and a random file of 40000 numbers,
+# both from a fixed linear congruential generator
+awk 'BEGIN { s = 12345; for (i = 0; i < 200; i++) {
+	s = (s * 1103515245 + 12345) % 2147483648; tc = 100 + s % 400;
+	s = (s * 1103515245 + 12345) % 2147483648; cb = 1 + s % 50;
+	s = (s * 1103515245 + 12345) % 2147483648; io = 1 + s % 50;
+	print i * 10, tc, cb, io } }' > "$DIR/input"
+awk 'BEGIN { s = 54321; print 40000; for (i = 0; i < 40000; i++) {
+	s = (s * 1103515245 + 12345) % 2147483648; print s } }' > "$DIR/rfile"
+NPROC=200
+
+# the finish time of the last process, from the SUM line
+finish_time() {
+	awk '/^SUM:/ { print $2 }'
+}
+
+# count of a -x histogram line: <NAME>: count p50 p90 p99 p99.9 max
+hist_count() {
+	awk -v name="$1:" '$1 == name { print $2 }'
+}
+
+# a resume under another scheduler keeps the latency histograms of the prefix
+check_cross_scheduler_resume() {
+	T=$($SCHED -sF "$DIR/input" "$DIR/rfile" | finish_time)
+	T=$((T / 2))
+	$SCHED -sF -k "$T:$DIR/ckpt" "$DIR/input" "$DIR/rfile" > /dev/null
+	$SCHED -x -sR5 -f "$DIR/ckpt" "$DIR/input" "$DIR/rfile" > "$DIR/resumed"
+	for hist in TURNAROUND RESPONSE; do
+		count=$(hist_count $hist < "$DIR/resumed")
+		[ "$count" = "$NPROC" ] || fail "resume F -> R5 at $T: $hist count $count, expected $NPROC"
+	done
+}
+
+# every process row: TT = TC + IT + CW, with io devices the queueing delay is IO time
+# row: <pid>: <at> <tc> <cb> <io> <prio> | <ft> <tt> <it> <cw>
+check_time_accounting() {
+	for spec in "" "-d 1" "-d 2:P" "-d 3 -c 2"; do
+		for s in F R5 E3:4; do
+			bad=$($SCHED $spec -s$s "$DIR/input" "$DIR/rfile" |
+				  awk '$1 ~ /^[0-9]+:$/ && $9 != $3 + $10 + $11 { bad++ } END { print bad + 0 }')
+			[ "$bad" = 0 ] || fail "$spec -s$s: $bad processes with TT != TC + IT + CW"
+		done
+	done
+}
+
+# LOTTERY with ticket totals beyond 31 bits still follows the shares:
+# SHARE ERROR: <mean |error| %> <max |error| %>
+check_large_lottery() {
+	printf "0 5000 10 5 2000000000\n0 5000 10 5 1000000000\n0 5000 10 5 2000000000\n0 5000 10 5 500000000\n" \
+		> "$DIR/tickets"
+	err=$($SCHED -sO2 "$DIR/tickets" "$DIR/rfile" | awk '/^SHARE ERROR:/ { print int($3) }')
+	[ -n "$err" ] && [ "$err" -lt 10 ] || fail "-sO2 with 5.5e9 tickets: mean share error $err%"
+}
+
+# MLFQ: the bottom level demotes nobody, and its quantum must fit an int
+# LEVEL <n>: quantum | dispatches | demotions, top level first
+check_mlfq_levels() {
+	bottom=$($SCHED -sM5:3 "$DIR/input" "$DIR/rfile" | awk '$1 == "LEVEL" && $2 == "2:" { print $5 }')
+	[ "$bottom" = 0 ] || fail "-sM5:3: $bottom demotions out of the bottom level"
+	$SCHED -sM65536:16 "$DIR/input" "$DIR/rfile" | grep -q "^Invalid scheduler param" ||
+		fail "-sM65536:16 accepted, its bottom quantum overflows an int"
+}
+
+# autotune: on this workload the average turnaround falls as the RR quantum
+# grows up to 9, so the tuned quantum is the one a sweep finds
+# BEST <quantum>:<maxprio>: p99 wait | the six SUM numbers
+check_autotune() {
+	best=$($SCHED -ott -sR5 "$DIR/input" "$DIR/rfile" | awk '$1 == "BEST" { print $2 }')
+	[ "$best" = "5:4:" ] || fail "-ott -sR5: BEST $best, expected 5:4:"
+	sweep=$(for q in 1 2 3 4 5 6 7 8 9; do
+		$SCHED -sR$q "$DIR/input" "$DIR/rfile" | awk -v q=$q '/^SUM:/ { print $5, q }'
+	done | sort -g | awk 'NR == 1 { print $2 ":4:" }')
+	best=$($SCHED -ott -sR9 "$DIR/input" "$DIR/rfile" | awk '$1 == "BEST" { print $2 }')
+	[ "$best" = "$sweep" ] || fail "-ott -sR9: BEST $best, a sweep finds $sweep"
+}
+
+check_cross_scheduler_resume
+check_time_accounting
+check_large_lottery
+check_mlfq_levels
+check_autotune
+
+if [ $FAILED = 0 ]; then
+	echo "All checks passed"
+fi
+exit $FAILED
@@ -0,0 +1,73 @@
+#include "histogram.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+const int HISTOGRAM_SUB_COUNT = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_HALF_COUNT = HISTOGRAM_SUB_COUNT / 2;
+
+Histogram::Histogram() :
+	counts((63 - HISTOGRAM_SUB_BITS) * HISTOGRAM_HALF_COUNT + HISTOGRAM_SUB_COUNT, 0) {}
+
+// magnitude m keeps the top HISTOGRAM_SUB_BITS bits of the value
+int Histogram::BucketIndex(long value) {
+	int bits = 64 - __builtin_clzl((unsigned long)value | 1);
+	int m = max(0, bits - HISTOGRAM_SUB_BITS);
+	return m * HISTOGRAM_HALF_COUNT + (int)(value >> m);
+}
+
+long Histogram::BucketHighest(int index) {
+	if (index < HISTOGRAM_SUB_COUNT) {
+		return index;
+	}
+	int m = index / HISTOGRAM_HALF_COUNT - 1;
+	long sub = index - m * HISTOGRAM_HALF_COUNT;
+	return ((sub + 1) << m) - 1;
+}
+
+void Histogram::Record(long value) {
+	value = max(value, 0L);
+	counts[BucketIndex(value)]++;
+	total++;
+	max_value = max(max_value, value);
+}
+
+long Histogram::Percentile(double p) {
+	if (total == 0) {
+		return 0;
+	}
+	uint64_t rank = max((uint64_t)1, (uint64_t)ceil(p / 100 * total));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < counts.size(); i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return min(BucketHighest(i), max_value);
+		}
+	}
+	return max_value;
+}
+
+void Histogram::Save(ostream &out) {
+	long used = count_if(counts.begin(), counts.end(), [](uint64_t c) { return c != 0; });
+	out << total << " " << max_value << " " << used;
+	for (size_t i = 0; i < counts.size(); i++) {
+		if (counts[i]) {
+			out << " " << i << " " << counts[i];
+		}
+	}
+	out << '\n';
+}
+
+void Histogram::Load(istream &in) {
+	long used = 0;
+	size_t index;
+	uint64_t count;
+	fill(counts.begin(), counts.end(), 0);
+	in >> total >> max_value >> used;
+	for (long i = 0; i < used && in >> index >> count; i++) {
+		if (index < counts.size()) {
+			counts[index] = count;
+		}
+	}
+}
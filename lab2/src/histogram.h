@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+#include <iosfwd>
+
+/*
+ * Log-linear (HDR style) histogram of non-negative values.
+ * Values below 2^HISTOGRAM_SUB_BITS get a bucket each, above that every
+ * power of two is split into 2^(HISTOGRAM_SUB_BITS - 1) equal buckets, so a
+ * percentile is off by less than 1/64 of its value. Memory is fixed, no
+ * matter how many values are recorded.
+ */
+const int HISTOGRAM_SUB_BITS = 7;
+
+class Histogram {
+private:
+	std::vector<uint64_t> counts;
+	uint64_t total = 0;
+	long max_value = 0;
+	static int BucketIndex(long value);
+	static long BucketHighest(int index); // largest value in the bucket
+public:
+	Histogram();
+	void Record(long value);
+	long Percentile(double p); // 0 < p <= 100
+	long Max() { return max_value; }
+	uint64_t Count() { return total; }
+	// checkpoints: the non-empty buckets
+	void Save(std::ostream &out);
+	void Load(std::istream &in);
+};
+
+#endif
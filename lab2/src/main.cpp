@@ -2,13 +2,29 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <sstream>
 #include <memory>
+#include <random>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <algorithm>
 // for getopt
 #include <unistd.h>
 #include <stdio.h>
 #include <iomanip>
+// for the Monte Carlo replicas
+#include <sys/wait.h>
+#include <cstring>
 
 #include "sched.h"
+#include "trace_sink.h"
+#include "trace_record.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "rand_table.h"
+#include "telemetry.h"
 
 // TRACING
 #ifndef DO_TRACE
@@ -18,26 +34,83 @@
 			printf(fmt); fflush(stdout); }  } while(0)
 #endif
 
+// 1: a single simulation loop with virtual scheduler calls (make sched_virtual)
+#ifndef GENERIC_SIMULATION
+#define GENERIC_SIMULATION 0
+#endif
+
 using namespace std;
 
 bool VERBOSE = false; // -v
 bool SHOW_SCHED_READY_QUEUE = false; // -t
 bool SHOW_EVENT_QUEUE = false; // -e
 bool SHOW_PRIO_PREEMPT = false; // -p
+bool STREAM_INPUT = false; // -l
+bool ASYNC_TRACE = false; // -w, drain the trace output on a background thread
+int NUM_CPUS = 1; // -c
+ofstream TRACE_RECORD; // -r, binary event trace
+int CHECKPOINT_TIME = -1; // -k <time>:<file>
+string CHECKPOINT_FILE;
+string RESUME_FILE; // -f, resume from a checkpoint
+bool CPU_AFFINITY = false; // -a, pin every process to cpu (pid % NUM_CPUS)
+bool EXTENDED_STATISTICS = false; // -x, latency percentiles
+bool RECORD_LATENCY = false; // -x, or -k: a resumed -x run reports the whole run
+int MONTE_CARLO = 0; // -m <replicas>[:<seed>]
+unsigned long MONTE_CARLO_SEED = 1; // replica i runs with seed + i
+vector<IODevice> IO_DEVICES; // -d <devices>[:F|P], none: unlimited parallel IO
+int HOSTS = 0; // -H <hosts>:<latency>[:<threshold>], coupled hosts
+int MIGRATION_LATENCY = 0; // lookahead of the host windows
+int MIGRATION_THRESHOLD = 2; // ready processes that make an unblocked one migrate
+int HOST_WORKERS = 0; // -j, hosts simulating at the same time, 0: one per core
+string TELEMETRY_SOCKET; // -u <socket>[:<interval ms>], live snapshots
+int TELEMETRY_INTERVAL = 1000;
+Telemetry *TELEMETRY = nullptr;
+string TUNE_OBJECTIVE; // -o tt|wait|tp[:<workers>], autotune quantum and maxprio
+int TUNE_WORKERS = 0; // candidates simulating at the same time, 0: one per core
 
-int EVENT_COUNTER = 0;
+long EVENTS_DISPATCHED = 0;
 int CURRENT_TIME = 0; 
 bool CALL_SCHEDULER = false;
-Process *CURRENT_RUNNING_PROCESS = nullptr;
+vector<int> RUNNING_PROCESS; // pid of the current running process of each cpu
+vector<int> CPU_BUSY_TIME; // time each cpu spends running processes
+vector<int> CPU_MIGRATIONS; // processes dispatched on a cpu they did not last run on
 int IO_USE = 0; // time at least one process is performing IO
 int LAST_IO_END_TIME = 0;
 
+// LOTTERY / STRIDE: entitlement of the runnable (ready or running) processes
+bool PROPORTIONAL_SHARE = false;
+double SHARE_CLOCK = 0; // cpu time each ticket was entitled to so far
+int SHARE_CLOCK_TIME = 0;
+long RUNNABLE_TICKETS = 0;
+int RUNNABLE_COUNT = 0;
+
+// EDF / RM: jobs (cpu bursts) of the processes with a period
+bool REAL_TIME = false;
+long DEADLINE_JOBS = 0;
+long DEADLINE_MISSES = 0;
+Histogram LATENESS_HIST; // completion past the deadline, of the missed jobs
+
+// -x: distributions behind the averages of the SUM line
+Histogram TURNAROUND_HIST;
+Histogram WAIT_HIST; // time in the ready queue, per dispatch
+Histogram RESPONSE_HIST; // arrival to first dispatch
+
 class RandGenerator {
+private:
+	vector<int> owned; // the text rfile, or the Seed() numbers
+	RandTableMapping table; // binary random table (rand_table.h)
+
 public:
 	int total = 0;
 	int ofs = -1;
-	vector<int> randvals;
+	const int *randvals = nullptr;
 	RandGenerator(string rfile_name) {
+		if (table.Map(rfile_name)) {
+			total = table.count;
+			randvals = table.values;
+			trace("Mapped RandGenerator table with %d numbers\n", total);
+			return;
+		}
 	// read in all the random numbers
 		ifstream rfile(rfile_name);
 		if (rfile) {
@@ -45,13 +118,21 @@ public:
 			trace("Initializing RandGenerator with %d numbers\n", total);
 			int num;
 			while (rfile >> num) {
-				randvals.push_back(num);
+				if (num < 0) {
+					cerr << "Random number " << num << " out of range" << endl;
+					exit(1);
+				}
+				owned.push_back(num);
 			}
+			randvals = owned.data();
 		} else {
 			cerr << "Not a valid random file <" << rfile_name << ">" << endl;
 			exit(1);
 		}
 	}
+
+	RandGenerator(const RandGenerator&) = delete; // owns the mapped table
+	RandGenerator& operator=(const RandGenerator&) = delete;
 	
 	int myrandom(int upper_bound) {
 		ofs++;
@@ -61,46 +142,224 @@ public:
 		}
 		return 1 + (randvals[ofs] % upper_bound);
 	}
+
+	// the same with the divisor's FastModReciprocal(), without a division
+	int myrandom(int upper_bound, uint64_t reciprocal) {
+		ofs++;
+		if (ofs == total) {
+			trace("Reseting offset to 0\n");
+			ofs = 0;
+		}
+		return 1 + FastMod(randvals[ofs], reciprocal, upper_bound);
+	}
+
+	// uniform in 0..n-1 for 0 < n <= LOTTERY_MAX_TICKETS, the numbers of the
+	// random file taken as uniform over 0..2^31-1: two of them make one 62-bit
+	// number when n is beyond 31 bits, and a number from the incomplete last
+	// multiple of n is rejected and drawn again. Draws myrandom(n) - 1 unless
+	// rejected, which for small n is rare.
+	long RandomBelow(long n) {
+		const long range31 = 1L << 31;
+		if (n < 1 || n > LOTTERY_MAX_TICKETS) {
+			cerr << "Can not draw uniformly from " << n << " numbers" << endl;
+			exit(1);
+		}
+		int draws = n <= range31 ? 1 : 2;
+		long range = draws == 1 ? range31 : range31 * range31;
+		long limit = range - range % n;
+		long num;
+		do {
+			num = 0;
+			for (int i = 0; i < draws; i++) {
+				ofs++;
+				if (ofs == total) {
+					trace("Reseting offset to 0\n");
+					ofs = 0;
+				}
+				num = num * range31 + randvals[ofs];
+			}
+		} while (num >= limit);
+		return num % n;
+	}
+
+	// the number myrandom() returns when called with the offset at k
+	int RandomAt(long k, int upper_bound) {
+		return 1 + (randvals[k % total] % upper_bound);
+	}
+
+	// advance the offset as if myrandom() was called count times
+	void Skip(long count) {
+		if (count > 0) {
+			ofs = (ofs + count) % total;
+		}
+	}
+
+	// Monte Carlo replica (-m): as many numbers of the same 31-bit range,
+	// drawn from a PRNG, and consumed from the start again
+	void Seed(unsigned long seed) {
+		mt19937_64 gen(seed);
+		owned.resize(total);
+		for (int &num: owned) {
+			num = gen() >> 33;
+		}
+		randvals = owned.data();
+		ofs = -1;
+	}
 };
 
-void TraceEventExecution(Process *proc, Event *evt, int time_in_prev_state, int cpu_burst = 0, int io_burst = 0) {
+// one process per line: <at> <tc> <cb> <io> [<tickets> [<period> [<deadline>]]]
+bool ReadProcessLine(istream &input, int &at, int &tc, int &cb, int &io, int &tickets, int &period, int &deadline) {
+	string line;
+	while (getline(input, line)) {
+		if (line.find_first_not_of(" \t\r") == string::npos) {
+			continue;
+		}
+		istringstream fields(line);
+		if (!(fields >> at >> tc >> cb >> io)) {
+			return false;
+		}
+		tickets = period = deadline = 0;
+		fields >> tickets >> period >> deadline;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Streaming input (-l): processes are read from the input file one at a time,
+ * when the previous arrival is dispatched, so the event queue holds a single
+ * arrival. The input must be sorted by arrival time.
+ * The static priority of process k is the k-th random number and bursts start
+ * after the n-th, exactly as if the whole file had been read upfront.
+ */
+class ProcessStream {
+public:
+	ifstream input;
+	const int maxprio;
+	long count = 0; // processes read so far
+	int last_arrival = 0;
+	ProcessStream(string infile_name, int maxprio) : input(infile_name), maxprio(maxprio) {}
+
+	// a pass over the file without storing anything, then rewind
+	long CountProcesses() {
+		long n = 0;
+		int at, tc, cb, io, tickets, period, deadline;
+		while (ReadProcessLine(input, at, tc, cb, io, tickets, period, deadline)) {
+			n++;
+		}
+		input.clear();
+		input.seekg(0);
+		return n;
+	}
+
+	// read the next process into the process table, NO_PID at end of file
+	int ReadNext(RandGenerator &rand) {
+		int arrival_time, total_cpu_time, cpu_burst, io_burst, tickets, period, deadline;
+		if (!ReadProcessLine(input, arrival_time, total_cpu_time, cpu_burst, io_burst, tickets, period, deadline)) {
+			return NO_PID;
+		}
+		if (arrival_time < last_arrival) {
+			cerr << "Input file is not sorted by arrival time <" << arrival_time << ">" << endl;
+			exit(1);
+		}
+		last_arrival = arrival_time;
+		int static_prio = rand.RandomAt(count++, maxprio);
+		return PROCESS_TABLE.Add(arrival_time, total_cpu_time, cpu_burst, io_burst, static_prio, tickets, period, deadline);
+	}
+};
+
+ProcessStream *PROCESS_STREAM = nullptr; // -l
+
+void PutNextArrival(DES &des, RandGenerator &rand) {
+	int pid = PROCESS_STREAM->ReadNext(rand);
+	if (pid != NO_PID) {
+		des.PutArrival(Event(pid,
+							 PROCESS_TABLE.arrival_time[pid],
+							 STATE_CREATED,
+							 STATE_READY,
+							 TRANS_TO_READY));
+	}
+}
+
+void TraceEventExecution(int pid, const Event &evt, int time_in_prev_state, int cpu_burst = 0, int io_burst = 0) {
+	ProcessTable &pt = PROCESS_TABLE;
 	// time stamp | PID | Time stayed in its prev state
-	cout << CURRENT_TIME << " " << proc->pid << " " << time_in_prev_state << ": ";
+	TRACE_OUT << CURRENT_TIME << " " << pid << " " << time_in_prev_state << ": ";
 	// Transition
-	cout << PROCESS_STATE_TO_STR[evt->old_state] << " -> "
-         << PROCESS_STATE_TO_STR[evt->new_state] << " ";
+	TRACE_OUT << PROCESS_STATE_TO_STR[evt.old_state] << " -> "
+         << PROCESS_STATE_TO_STR[evt.new_state] << " ";
 	
-	switch (evt->transition) {
+	switch (evt.transition) {
 		case TRANS_TO_READY:
-			cout << endl;
+			TRACE_OUT << '\n';
 			break;
 		case TRANS_TO_PREEMPT:
 			// (rem) cb | rem | (dynamic) prio    
-			cout << " cb=" << proc->rem_cpu_burst << " rem=" << proc->rem_cpu_time << " prio=" << proc->dynamic_prio << endl;
+			TRACE_OUT << " cb=" << pt.rem_cpu_burst[pid] << " rem=" << pt.rem_cpu_time[pid] << " prio=" << pt.dynamic_prio[pid] << '\n';
 			break;
 
 		case TRANS_TO_RUN:
 			// cb | rem | (dynamic) prio	
-			cout << " cb=" << cpu_burst << " rem=" << proc->rem_cpu_time << " prio=" << proc->dynamic_prio << endl;
+			TRACE_OUT << " cb=" << cpu_burst << " rem=" << pt.rem_cpu_time[pid] << " prio=" << pt.dynamic_prio[pid];
+			if (NUM_CPUS > 1) {
+				TRACE_OUT << " cpu=" << pt.cpu[pid];
+			}
+			TRACE_OUT << '\n';
 			break;
 
 		case TRANS_TO_BLOCK:
-			if (proc->rem_cpu_time) {
+			if (pt.rem_cpu_time[pid]) {
 				// ib | rem
-				cout << " ib=" << io_burst << " rem=" << proc->rem_cpu_time << endl;
+				TRACE_OUT << " ib=" << io_burst << " rem=" << pt.rem_cpu_time[pid] << '\n';
 			} else {
-				cout << "Done" << endl;
+				TRACE_OUT << "Done" << '\n';
 			}
 	}
 
 }
 
-void AddEventToEventQ(DES &des, Event *evt) {
+/*
+ * Binary trace (-r): the same values TraceEventExecution prints, as one
+ * fixed-size record per dispatched event (see trace_record.h)
+ */
+void RecordProcess(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	TraceRecord rec = {};
+	rec.kind = REC_PROCESS;
+	rec.time_stamp = pt.arrival_time[pid];
+	rec.pid = pid;
+	rec.cpu_burst = pt.cpu_burst[pid];
+	rec.io_burst = pt.io_burst[pid];
+	rec.rem = pt.total_cpu_time[pid];
+	rec.prio = pt.static_prio[pid];
+	rec.cpu = -1;
+	TRACE_RECORD.write((const char*)&rec, sizeof(rec));
+}
+
+void RecordEvent(int pid, const Event &evt, int time_in_prev_state, int cpu_burst = 0, int io_burst = 0) {
+	ProcessTable &pt = PROCESS_TABLE;
+	TraceRecord rec = {};
+	rec.kind = REC_EVENT;
+	rec.time_stamp = CURRENT_TIME;
+	rec.pid = pid;
+	rec.time_in_prev_state = time_in_prev_state;
+	rec.cpu_burst = evt.transition == TRANS_TO_PREEMPT ? pt.rem_cpu_burst[pid] : cpu_burst;
+	rec.io_burst = io_burst;
+	rec.rem = pt.rem_cpu_time[pid];
+	rec.prio = pt.dynamic_prio[pid];
+	rec.cpu = pt.cpu[pid];
+	rec.transition = evt.transition;
+	rec.old_state = evt.old_state;
+	rec.new_state = evt.new_state;
+	TRACE_RECORD.write((const char*)&rec, sizeof(rec));
+}
+
+void AddEventToEventQ(DES &des, const Event &evt) {
 	// Before insertion
 	if (SHOW_EVENT_QUEUE) {
-		cout << "  AddEvent(" << evt->time_stamp << ":"
-			 << evt->process->pid << ":" 
-			 << TRANSITION_TO_STR[evt->transition] << "):";
+		TRACE_OUT << "  AddEvent(" << evt.time_stamp << ":"
+			 << evt.pid << ":" 
+			 << TRANSITION_TO_STR[evt.transition] << "):";
 	  des.ShowEventQ();
 	} 
 	
@@ -108,9 +367,9 @@ void AddEventToEventQ(DES &des, Event *evt) {
 	
 	// After insertion
 	if (SHOW_EVENT_QUEUE) {
-		cout << " ==>";
+		TRACE_OUT << " ==>";
 		des.ShowEventQ();
-		cout << endl;
+		TRACE_OUT << '\n';
 	} 
 }
 
@@ -123,61 +382,642 @@ void update_io_use(int io_burst) {
 	}
 }
 
-void simulation(DES &des, Scheduler &sched, RandGenerator &rand) {
+/*
+ * I/O devices (-d): a blocking process requests the device with the least
+ * load (busy + queued). Its READY event is created when its service starts,
+ * and the end of the service starts the next request in the device queue.
+ */
+int SelectIODevice() {
+	int best = 0;
+	for (int d = 1; d < (int)IO_DEVICES.size(); d++) {
+		if (IO_DEVICES[d].Outstanding() < IO_DEVICES[best].Outstanding()) {
+			best = d;
+		}
+	}
+	return best;
+}
+
+void StartIO(DES &des, IODevice &dev, int pid, int io_burst, int enqueue_time) {
+	trace("IO of process %d starts, burst %d, queued %d\n", pid, io_burst, CURRENT_TIME - enqueue_time);
+	dev.current = pid;
+	dev.requests++;
+	dev.busy_time += io_burst;
+	dev.queue_delay += CURRENT_TIME - enqueue_time;
+	// blocked while queued too, so the delay counts as IO time of the process
+	PROCESS_TABLE.io_time[pid] += CURRENT_TIME - enqueue_time;
+	update_io_use(io_burst);
+	AddEventToEventQ(des, Event(pid,
+								CURRENT_TIME + io_burst,
+								STATE_BLOCKED,
+								STATE_READY,
+								TRANS_TO_READY));
+}
+
+void RequestIO(DES &des, int pid, int io_burst) {
+	IODevice &dev = IO_DEVICES[SelectIODevice()];
+	if (dev.Busy()) {
+		dev.Enqueue(pid, io_burst, CURRENT_TIME);
+	} else {
+		StartIO(des, dev, pid, io_burst, CURRENT_TIME);
+	}
+}
+
+void CompleteIO(DES &des, int pid) {
+	for (IODevice &dev: IO_DEVICES) {
+		if (dev.current != pid) {
+			continue;
+		}
+		dev.current = NO_PID;
+		if (!dev.queue.empty()) {
+			IORequest req = dev.Dequeue();
+			StartIO(des, dev, req.pid, req.io_burst, req.enqueue_time);
+		}
+		return;
+	}
+}
+
+/*
+ * Proportional share entitlement (LOTTERY / STRIDE): while runnable a
+ * process is entitled to min(cpus, runnable processes) * tickets / runnable
+ * tickets of the cpu time. Exact on one cpu, an approximation on several.
+ */
+void AdvanceShareClock() {
+	if (RUNNABLE_TICKETS > 0) {
+		SHARE_CLOCK += (double)(CURRENT_TIME - SHARE_CLOCK_TIME) * min(NUM_CPUS, RUNNABLE_COUNT) / RUNNABLE_TICKETS;
+	}
+	SHARE_CLOCK_TIME = CURRENT_TIME;
+}
+
+void ShareJoin(int pid) {
+	AdvanceShareClock();
+	PROCESS_TABLE.share_clock_start[pid] = SHARE_CLOCK;
+	RUNNABLE_TICKETS += PROCESS_TABLE.tickets[pid];
+	RUNNABLE_COUNT++;
+}
+
+void ShareLeave(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	AdvanceShareClock();
+	pt.entitled_cpu_time[pid] += pt.tickets[pid] * (SHARE_CLOCK - pt.share_clock_start[pid]);
+	RUNNABLE_TICKETS -= pt.tickets[pid];
+	RUNNABLE_COUNT--;
+}
+
+/*
+ * Pick the cpu whose run queue receives a process that becomes ready.
+ * Pinned processes always go home, a woken up process returns to the cpu
+ * it last ran on (warm cache) and a new arrival goes to the least loaded cpu.
+ */
+template <class S>
+int SelectCPU(vector<S*> &scheds, int pid) {
+	if (CPU_AFFINITY) {
+		return pid % NUM_CPUS;
+	}
+	if (PROCESS_TABLE.cpu[pid] >= 0) {
+		return PROCESS_TABLE.cpu[pid];
+	}
+	int cpu = 0;
+	int min_load = -1;
+	for (int i = 0; i < NUM_CPUS; i++) {
+		int load = scheds[i]->ReadyCount() + (RUNNING_PROCESS[i] != NO_PID);
+		if (min_load < 0 || load < min_load) {
+			min_load = load;
+			cpu = i;
+		}
+	}
+	return cpu;
+}
+
+/*
+ * Work stealing: an idle cpu with an empty run queue pulls the next process
+ * from the cpu with the longest run queue. <queued> is the number of ready
+ * processes on all cpus, without it every idle cpu would scan all cpus.
+ */
+template <class S>
+int StealProcess(vector<S*> &scheds, int cpu, int queued) {
+	if (CPU_AFFINITY || queued == 0) {
+		return NO_PID;
+	}
+	int victim = -1;
+	int max_load = 0;
+	for (int i = 0; i < NUM_CPUS; i++) {
+		if (i != cpu && scheds[i]->ReadyCount() > max_load) {
+			max_load = scheds[i]->ReadyCount();
+			victim = i;
+		}
+	}
+	if (victim < 0) {
+		return NO_PID;
+	}
+	trace("CPU %d steals from CPU %d (%d ready)\n", cpu, victim, max_load);
+	return scheds[victim]->GetNextProcess();
+}
+
+/*
+ * Checkpoints (-k <time>:<file>, -f <file>): a text snapshot of the event
+ * queue, process table, cpus, ready queues and the random offset, taken
+ * between events once nothing before <time> is left to dispatch.
+ * A resumed run continues exactly like the original one. It may use a
+ * different scheduler (same number of cpus), which then receives the ready
+ * processes through AddProcess().
+ */
+const int CHECKPOINT_VERSION = 10;
+
+void WriteEvent(ofstream &out, const Event &evt) {
+	out << evt.pid << " " << evt.time_stamp << " " << (int)evt.old_state << " "
+		<< (int)evt.new_state << " " << (int)evt.transition << '\n';
+}
+
+void WriteCheckpoint(DES &des, vector<Scheduler*> &scheds, RandGenerator &rand) {
+	perfStart(checkpoint_start);
+	trace("Checkpoint at %d to %s\n", CURRENT_TIME, &CHECKPOINT_FILE[0]);
+	ProcessTable &pt = PROCESS_TABLE;
+	ofstream out(CHECKPOINT_FILE);
+	if (!out) {
+		cerr << "Not a valid checkpoint file <" << CHECKPOINT_FILE << ">" << endl;
+		exit(1);
+	}
+	out << setprecision(17); // doubles read back exactly
+	out << "SCHEDCKPT " << CHECKPOINT_VERSION << '\n';
+	out << scheds[0]->sched_type << " " << scheds[0]->quantum << " " << NUM_CPUS << '\n';
+	out << CURRENT_TIME << " " << IO_USE << " " << LAST_IO_END_TIME << " " << rand.ofs << " " << EVENTS_DISPATCHED << '\n';
+	out << SHARE_CLOCK << " " << SHARE_CLOCK_TIME << " " << RUNNABLE_TICKETS << " " << RUNNABLE_COUNT << '\n';
+	if (PROCESS_STREAM) {
+		out << "1 " << PROCESS_STREAM->count << " " << PROCESS_STREAM->last_arrival << " "
+			<< (long)PROCESS_STREAM->input.tellg() << '\n';
+	} else {
+		out << "0" << '\n';
+	}
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		out << RUNNING_PROCESS[cpu] << " " << CPU_BUSY_TIME[cpu] << " " << CPU_MIGRATIONS[cpu] << '\n';
+	}
+
+	out << pt.Size() << '\n';
+	for (int pid = 0; pid < pt.Size(); pid++) {
+		out << pt.arrival_time[pid] << " " << pt.total_cpu_time[pid] << " "
+			<< pt.cpu_burst[pid] << " " << pt.io_burst[pid] << " " << pt.static_prio[pid] << " "
+			<< pt.rem_cpu_time[pid] << " " << pt.dynamic_prio[pid] << " " << pt.state_time_stamp[pid] << " "
+			<< pt.rem_cpu_burst[pid] << " " << pt.cpu[pid] << " " << pt.time_to_pending_evt[pid] << " "
+			<< pt.wait_time[pid] << " " << pt.io_time[pid] << " " << pt.finish_time[pid] << " "
+			<< pt.vruntime[pid] << " " << pt.charged_cpu_time[pid] << " "
+			<< pt.mlfq_level[pid] << " " << pt.level_cpu_time[pid] << " " << pt.boost_epoch[pid] << " "
+			<< pt.tickets[pid] << " " << pt.share_clock_start[pid] << " " << pt.entitled_cpu_time[pid] << " "
+			<< pt.period[pid] << " " << pt.deadline[pid] << " " << pt.abs_deadline[pid] << '\n';
+	}
+
+	out << des.has_arrival << '\n';
+	if (des.has_arrival) {
+		WriteEvent(out, des.arrival);
+	}
+	vector<Event> queued = des.QueuedEvents();
+	out << queued.size() << '\n';
+	for (const Event &evt: queued) {
+		WriteEvent(out, evt);
+	}
+	out << IO_DEVICES.size() << '\n';
+	for (IODevice &dev: IO_DEVICES) {
+		dev.Save(out);
+	}
+	TURNAROUND_HIST.Save(out);
+	WAIT_HIST.Save(out);
+	RESPONSE_HIST.Save(out);
+	out << DEADLINE_JOBS << " " << DEADLINE_MISSES << '\n';
+	LATENESS_HIST.Save(out);
+
+	// ready queues for any scheduler, then the exact state for the same one
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		vector<int> ready = scheds[cpu]->ReadyList();
+		out << ready.size();
+		for (int pid: ready) {
+			out << " " << pid;
+		}
+		out << '\n';
+	}
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		scheds[cpu]->SaveState(out);
+	}
+	if (!out) {
+		cerr << "Failed writing checkpoint <" << CHECKPOINT_FILE << ">" << endl;
+		exit(1);
+	}
+	perfStop(PERF_PHASE_CHECKPOINT, checkpoint_start);
+}
+
+// called between events, when no scheduler call is pending
+void CheckpointIfDue(DES &des, vector<Scheduler*> &scheds, RandGenerator &rand) {
+	if (CHECKPOINT_TIME >= 0 && des.GetNextEventTime() >= CHECKPOINT_TIME) {
+		WriteCheckpoint(des, scheds, rand);
+		CHECKPOINT_TIME = -1;
+	}
+}
+
+Event ReadEvent(ifstream &in) {
+	int pid, ts, os, ns, t;
+	in >> pid >> ts >> os >> ns >> t;
+	return Event(pid, ts, (ProcessState)os, (ProcessState)ns, (Transition)t);
+}
+
+void ReadCheckpoint(DES &des, vector<Scheduler*> &scheds, RandGenerator &rand, string infile_name, int maxprio) {
+	trace("Resuming from checkpoint %s\n", &RESUME_FILE[0]);
+	ProcessTable &pt = PROCESS_TABLE;
+	ifstream in(RESUME_FILE);
+	string magic;
+	int version = 0;
+	if (!(in >> magic >> version) || magic != "SCHEDCKPT" || version != CHECKPOINT_VERSION) {
+		cerr << "Not a valid checkpoint file <" << RESUME_FILE << ">" << endl;
+		exit(1);
+	}
+	string sched_type;
+	int quantum, num_cpus;
+	in >> sched_type >> quantum >> num_cpus;
+	if (num_cpus != NUM_CPUS) {
+		cerr << "Checkpoint was taken with " << num_cpus << " cpus" << endl;
+		exit(1);
+	}
+	bool same_scheduler = sched_type == scheds[0]->sched_type && quantum == scheds[0]->quantum;
+	in >> CURRENT_TIME >> IO_USE >> LAST_IO_END_TIME >> rand.ofs >> EVENTS_DISPATCHED;
+	in >> SHARE_CLOCK >> SHARE_CLOCK_TIME >> RUNNABLE_TICKETS >> RUNNABLE_COUNT;
+
+	int streamed = 0;
+	in >> streamed;
+	if (streamed) {
+		long pos;
+		PROCESS_STREAM = new ProcessStream(infile_name, maxprio);
+		in >> PROCESS_STREAM->count >> PROCESS_STREAM->last_arrival >> pos;
+		if (pos >= 0) {
+			PROCESS_STREAM->input.seekg(pos);
+		} else {
+			PROCESS_STREAM->input.seekg(0, ios::end);
+		}
+	}
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		in >> RUNNING_PROCESS[cpu] >> CPU_BUSY_TIME[cpu] >> CPU_MIGRATIONS[cpu];
+	}
+
+	int nproc = 0;
+	in >> nproc;
+	for (int i = 0; i < nproc && in; i++) {
+		int at, tc, cb, io, prio;
+		in >> at >> tc >> cb >> io >> prio;
+		int pid = pt.Add(at, tc, cb, io, prio);
+		in >> pt.rem_cpu_time[pid] >> pt.dynamic_prio[pid] >> pt.state_time_stamp[pid]
+		   >> pt.rem_cpu_burst[pid] >> pt.cpu[pid] >> pt.time_to_pending_evt[pid]
+		   >> pt.wait_time[pid] >> pt.io_time[pid] >> pt.finish_time[pid]
+		   >> pt.vruntime[pid] >> pt.charged_cpu_time[pid]
+		   >> pt.mlfq_level[pid] >> pt.level_cpu_time[pid] >> pt.boost_epoch[pid]
+		   >> pt.tickets[pid] >> pt.share_clock_start[pid] >> pt.entitled_cpu_time[pid]
+		   >> pt.period[pid] >> pt.deadline[pid] >> pt.abs_deadline[pid];
+		if (prio > maxprio && (scheds[0]->sched_type == "PRIO" || scheds[0]->sched_type == "PREPRIO")) {
+			cerr << "Checkpoint priority " << prio << " of process " << pid << " exceeds maxprio " << maxprio << endl;
+			exit(1);
+		}
+	}
+
+	int has_arrival = 0;
+	in >> has_arrival;
+	if (has_arrival) {
+		des.PutArrival(ReadEvent(in));
+	}
+	long nevents = 0;
+	in >> nevents;
+	for (long i = 0; i < nevents && in; i++) {
+		des.PutEvent(ReadEvent(in)); // saved in queue order
+	}
+	size_t ndevices = 0;
+	in >> ndevices;
+	if (ndevices != IO_DEVICES.size()) {
+		cerr << "Checkpoint was taken with " << ndevices << " io devices" << endl;
+		exit(1);
+	}
+	for (IODevice &dev: IO_DEVICES) {
+		dev.Load(in);
+	}
+	TURNAROUND_HIST.Load(in);
+	WAIT_HIST.Load(in);
+	RESPONSE_HIST.Load(in);
+	in >> DEADLINE_JOBS >> DEADLINE_MISSES;
+	LATENESS_HIST.Load(in);
+
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		int nready = 0, pid;
+		in >> nready;
+		for (int i = 0; i < nready && in >> pid; i++) {
+			scheds[cpu]->AddProcess(pid);
+		}
+	}
+	if (same_scheduler) {
+		for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+			scheds[cpu]->LoadState(in);
+		}
+	}
+	if (!in) {
+		cerr << "Truncated checkpoint file <" << RESUME_FILE << ">" << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Coupled hosts (-H): every host is a copy of the simulator in a process of
+ * its own, with every HOSTS-th process of the input. A process whose IO
+ * completes while at least MIGRATION_THRESHOLD processes are ready on its
+ * host moves on to the next host and arrives there MIGRATION_LATENCY later.
+ * Hosts simulate conservative windows [T, T + latency) granted by the
+ * coordinator: a migration sent in a window arrives after its end, so no
+ * host ever receives one in its past. Migrated processes are arrivals (ahead
+ * of queued events with the same time stamp), taken in (arrival time, source
+ * host, send order), so the results do not depend on the window boundaries
+ * or on which hosts run at the same time.
+ */
+struct Migration {
+	int arrive_time;
+	int src_host;
+	long seq;
+	int dst_host;
+	int send_time;
+	// the process as it left the source host
+	int arrival_time;
+	int total_cpu_time;
+	int cpu_burst;
+	int io_burst;
+	int static_prio;
+	int tickets;
+	int period;
+	int deadline;
+	int rem_cpu_time;
+	int wait_time;
+	int io_time;
+	bool operator<(const Migration &other) const {
+		if (arrive_time != other.arrive_time) {
+			return arrive_time < other.arrive_time;
+		}
+		return src_host != other.src_host ? src_host < other.src_host : seq < other.seq;
+	}
+};
+
+// coordinator -> host: simulate the events before window_end, then report.
+// window_end < 0: the simulation is over
+struct WindowGrant {
+	int window_end;
+	int migrations; // Migration records that follow
+};
+
+// host -> coordinator, after each window
+struct WindowReport {
+	int next_time; // of the earliest event or incoming migration, -1: none
+	int migrations; // Migration records that follow
+};
+
+// host -> coordinator, at the end
+struct HostResult {
+	int last_time;
+	long cpu_busy;
+	long io_use;
+	long finished; // processes that completed on this host
+	double sum_TT;
+	double sum_cpu_wait;
+	long migrated_in;
+	long migrated_out;
+};
+
+int HOST = -1; // this host, in a host process
+int WINDOW_END = 0;
+int HOST_GRANTS = -1; // coordinator -> host pipe
+int HOST_REPORTS = -1; // host -> coordinator pipe
+set<Migration> INBOX; // delivered, not arrived yet
+vector<Migration> OUTBOX; // sent in the current window
+long MIGRATIONS_SENT = 0;
+long MIGRATIONS_RECEIVED = 0;
+
+bool ReadAll(int fd, void *buf, size_t size) {
+	char *p = (char*)buf;
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool WriteAll(int fd, const void *buf, size_t size) {
+	const char *p = (const char*)buf;
+	while (size > 0) {
+		ssize_t n = write(fd, p, size);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+void MigrateOut(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	trace("Process %d migrates to host %d\n", pid, (HOST + 1) % HOSTS);
+	OUTBOX.push_back({CURRENT_TIME + MIGRATION_LATENCY, HOST, MIGRATIONS_SENT++, (HOST + 1) % HOSTS, CURRENT_TIME,
+					  pt.arrival_time[pid], pt.total_cpu_time[pid], pt.cpu_burst[pid], pt.io_burst[pid],
+					  pt.static_prio[pid], pt.tickets[pid], pt.period[pid], pt.deadline[pid],
+					  pt.rem_cpu_time[pid], pt.wait_time[pid], pt.io_time[pid]});
+	pt.migrated[pid] = 1;
+}
+
+// the earliest delivered migration becomes the pending arrival, once the
+// window reaches its arrival time
+void MigrateIn(DES &des) {
+	if (des.has_arrival || INBOX.empty() || INBOX.begin()->arrive_time >= WINDOW_END) {
+		return;
+	}
+	const Migration &m = *INBOX.begin();
+	ProcessTable &pt = PROCESS_TABLE;
+	int pid = pt.Add(m.arrival_time, m.total_cpu_time, m.cpu_burst, m.io_burst, m.static_prio, m.tickets, m.period, m.deadline);
+	pt.rem_cpu_time[pid] = m.rem_cpu_time;
+	pt.wait_time[pid] = m.wait_time;
+	pt.io_time[pid] = m.io_time;
+	pt.state_time_stamp[pid] = m.send_time;
+	trace("Process %d arrives from host %d at %d\n", pid, m.src_host, m.arrive_time);
+	des.PutArrival(Event(pid, m.arrive_time, STATE_CREATED, STATE_READY, TRANS_TO_READY));
+	MIGRATIONS_RECEIVED++;
+	INBOX.erase(INBOX.begin());
+}
+
+// report the window just simulated and wait for the next one, false when
+// the simulation is over
+bool SyncWindow(DES &des) {
+	WindowReport report = {des.GetNextEventTime(), (int)OUTBOX.size()};
+	if (!INBOX.empty() && (report.next_time < 0 || INBOX.begin()->arrive_time < report.next_time)) {
+		report.next_time = INBOX.begin()->arrive_time;
+	}
+	WindowGrant grant;
+	if (!WriteAll(HOST_REPORTS, &report, sizeof(report))
+		|| !WriteAll(HOST_REPORTS, OUTBOX.data(), OUTBOX.size() * sizeof(Migration))
+		|| !ReadAll(HOST_GRANTS, &grant, sizeof(grant))) {
+		_exit(1);
+	}
+	OUTBOX.clear();
+	for (int i = 0; i < grant.migrations; i++) {
+		Migration m;
+		if (!ReadAll(HOST_GRANTS, &m, sizeof(m))) {
+			_exit(1);
+		}
+		INBOX.insert(m);
+	}
+	WINDOW_END = grant.window_end;
+	return WINDOW_END >= 0;
+}
+
+// -H: the next event of the current window, windows are synchronized with
+// the other hosts as needed
+bool NextHostEvent(DES &des, Event &evt) {
+	while (true) {
+		MigrateIn(des);
+		int next = des.GetNextEventTime();
+		if (next >= 0 && next < WINDOW_END) {
+			des.GetEvent(evt);
+			MigrateIn(des); // so a time step includes the arrivals at its time
+			return true;
+		}
+		if (!SyncWindow(des)) {
+			return false;
+		}
+	}
+}
+
+// EDF / RM: the cpu burst of a process with a period just ended
+void CompleteJob(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	DEADLINE_JOBS++;
+	if (CURRENT_TIME > pt.abs_deadline[pid]) {
+		trace("Process %d misses its deadline %d by %d\n", pid, pt.abs_deadline[pid], CURRENT_TIME - pt.abs_deadline[pid]);
+		DEADLINE_MISSES++;
+		LATENESS_HIST.Record(CURRENT_TIME - pt.abs_deadline[pid]);
+	}
+}
+
+// -u: one update of the telemetry block per time step
+template <class S>
+void PublishTelemetry(vector<S*> &scheds) {
+	long cpu_busy = 0;
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		cpu_busy += CPU_BUSY_TIME[cpu];
+	}
+	TELEMETRY->BeginUpdate();
+	TELEMETRY->SetCounters(CURRENT_TIME, EVENTS_DISPATCHED, cpu_busy, IO_USE);
+	for (int cpu = 0; cpu < TELEMETRY->ReportedCPUs(); cpu++) {
+		TELEMETRY->SetCPU(cpu, scheds[cpu]->ReadyCount(), RUNNING_PROCESS[cpu]);
+	}
+	TELEMETRY->EndUpdate();
+}
+
+template <class S>
+int ReadyProcesses(vector<S*> &scheds) {
+	int ready = 0;
+	for (S *sched: scheds) {
+		ready += sched->ReadyCount();
+	}
+	return ready;
+}
+
+/*
+ * The event loop, instantiated per scheduler class. With a final class S
+ * the scheduler calls are direct calls instead of virtual ones.
+ * S = Scheduler is the generic loop for any scheduler.
+ */
+template <class S>
+void simulation(DES &des, vector<Scheduler*> &base_scheds, RandGenerator &rand) {
 	trace("Simluation starts...\n");
-	trace("Scheduler Type: %s\n", &sched.sched_type[0]);
-	Event *evt;
-	while (evt = des.GetEvent()) {
-		trace("Get Event %d, time stamp: %d, pid: %d, old state: %s, new state: %s\n",
-			   evt->eid,  
-               evt->time_stamp, 
-			   evt->process->pid,
-			   &PROCESS_STATE_TO_STR[evt->old_state][0],
-			   &PROCESS_STATE_TO_STR[evt->new_state][0]);
-		Process *proc = evt->process; // this is the process the event works on
-		CURRENT_TIME = evt->time_stamp;
-		int transition = evt->transition;
-		int old_state = evt->old_state;
-		int new_state = evt->new_state;
-		int time_in_prev_state = CURRENT_TIME - proc->state_time_stamp;
-		proc->state_time_stamp = CURRENT_TIME;
+	trace("Scheduler Type: %s, CPUs: %d\n", &base_scheds[0]->sched_type[0], NUM_CPUS);
+	ProcessTable &pt = PROCESS_TABLE;
+	vector<S*> scheds;
+	for (Scheduler *sched: base_scheds) {
+		scheds.push_back(static_cast<S*>(sched));
+	}
+	Event evt;
+	CheckpointIfDue(des, base_scheds, rand);
+	while (HOSTS ? NextHostEvent(des, evt) : des.GetEvent(evt)) {
+		perfStart(event_start);
+		perfCount(events[evt.transition]);
+		EVENTS_DISPATCHED++;
+		trace("Get Event %u, time stamp: %d, pid: %d, old state: %s, new state: %s\n",
+			   evt.seq,  
+               evt.time_stamp, 
+			   evt.pid,
+			   &PROCESS_STATE_TO_STR[evt.old_state][0],
+			   &PROCESS_STATE_TO_STR[evt.new_state][0]);
+		int pid = evt.pid; // this is the process the event works on
+		if (PROCESS_STREAM && evt.old_state == STATE_CREATED) {
+			PutNextArrival(des, rand);
+		}
+		CURRENT_TIME = evt.time_stamp;
+		int transition = evt.transition;
+		int old_state = evt.old_state;
+		int new_state = evt.new_state;
+		int time_in_prev_state = CURRENT_TIME - pt.state_time_stamp[pid];
+		pt.state_time_stamp[pid] = CURRENT_TIME;
+		if (TRACE_RECORD.is_open() && old_state == STATE_CREATED) {
+			RecordProcess(pid);
+		}
 		if (DO_TRACE > 3) {
 			des.TraceEventQ();
 		}
 		
 		int cpu_burst = 0;
 		int io_burst = 0;
+		int cpu;
+		int quantum;
+		int running;
 		switch(transition) {
 		case TRANS_TO_READY:
 			if (VERBOSE) {
-				TraceEventExecution(proc, evt, time_in_prev_state);
+				TraceEventExecution(pid, evt, time_in_prev_state);
 			}			
+			if (TRACE_RECORD.is_open()) {
+				RecordEvent(pid, evt, time_in_prev_state);
+			}
+			if (!IO_DEVICES.empty() && evt.old_state == STATE_BLOCKED) {
+				CompleteIO(des, pid);
+			}
+			if (HOSTS > 1 && evt.old_state == STATE_BLOCKED && ReadyProcesses(scheds) >= MIGRATION_THRESHOLD) {
+				MigrateOut(pid);
+				break;
+			}
+			if (REAL_TIME) {
+				// the next job is released
+				pt.abs_deadline[pid] = CURRENT_TIME + pt.deadline[pid];
+			}
 			
-			if (evt->old_state == STATE_BLOCKED) {		
-				proc->dynamic_prio = proc->static_prio - 1;	
+			if (evt.old_state == STATE_BLOCKED) {		
+				pt.dynamic_prio[pid] = pt.static_prio[pid] - 1;	
+			}
+			if (PROPORTIONAL_SHARE) {
+				ShareJoin(pid);
 			}
-			sched.AddProcess(proc);
+			cpu = SelectCPU(scheds, pid);
+			scheds[cpu]->AddProcess(pid);
 			
 			// check priority preemption
-			if (CURRENT_RUNNING_PROCESS) {
-				CURRENT_RUNNING_PROCESS->pending_evt = des.GetPendingEventByPID(CURRENT_RUNNING_PROCESS->pid);
+			running = RUNNING_PROCESS[cpu];
+			if (running != NO_PID) {
+				pt.pending_evt[running] = des.GetPendingEventByPID(running);
 			}
 			
-			if (sched.TestPreempt(proc, CURRENT_TIME, CURRENT_RUNNING_PROCESS)) {
+			if (scheds[cpu]->TestPreempt(pid, CURRENT_TIME, running)) {
+				perfCount(priority_preemptions);
 			
 				// remove future event for the current running process
-				CURRENT_RUNNING_PROCESS->rem_cpu_time += CURRENT_RUNNING_PROCESS->time_to_pending_evt;
-				CURRENT_RUNNING_PROCESS->rem_cpu_burst += CURRENT_RUNNING_PROCESS->time_to_pending_evt; 
-				des.RemoveEvent(CURRENT_RUNNING_PROCESS->pending_evt->eid);				
+				pt.rem_cpu_time[running] += pt.time_to_pending_evt[running];
+				pt.rem_cpu_burst[running] += pt.time_to_pending_evt[running]; 
+				CPU_BUSY_TIME[cpu] -= pt.time_to_pending_evt[running];
+				des.RemoveEvent(running);				
 				// add a new preemption event for the current time stamp	
 				
-				Event *evt = new Event(CURRENT_RUNNING_PROCESS,
-							    	   CURRENT_TIME,
-							    	   STATE_RUNNING,
-							    	   STATE_READY,
-							    	   TRANS_TO_PREEMPT);
-
-				des.PutEvent(evt);
+				des.PutEvent(Event(running,
+								   CURRENT_TIME,
+								   STATE_RUNNING,
+								   STATE_READY,
+								   TRANS_TO_PREEMPT));
 			}
 
 			CALL_SCHEDULER = true;
@@ -186,176 +1026,962 @@ void simulation(DES &des, Scheduler &sched, RandGenerator &rand) {
 			// must come from RUNNING
 			// add to runqueue (no event is generated)
 			if (VERBOSE) {
-				TraceEventExecution(proc, evt, time_in_prev_state);
+				TraceEventExecution(pid, evt, time_in_prev_state);
+			}
+			if (TRACE_RECORD.is_open()) {
+				RecordEvent(pid, evt, time_in_prev_state);
 			}
-			proc->dynamic_prio -= 1;
-			sched.AddProcess(proc);
+			pt.dynamic_prio[pid] -= 1;
+			RUNNING_PROCESS[pt.cpu[pid]] = NO_PID;
+			scheds[SelectCPU(scheds, pid)]->AddProcess(pid);
 			
-			CURRENT_RUNNING_PROCESS = nullptr;
 			CALL_SCHEDULER = true;
 			break;
 		case TRANS_TO_RUN:
 			// get cpu_burst
-			if (CURRENT_RUNNING_PROCESS->rem_cpu_burst) {
-				cpu_burst = CURRENT_RUNNING_PROCESS->rem_cpu_burst;
-				trace("Remaining cpu_burst: %d\n", CURRENT_RUNNING_PROCESS->rem_cpu_burst);
+			if (pt.rem_cpu_burst[pid]) {
+				cpu_burst = pt.rem_cpu_burst[pid];
+				trace("Remaining cpu_burst: %d\n", pt.rem_cpu_burst[pid]);
 			} else {
-				cpu_burst = rand.myrandom(CURRENT_RUNNING_PROCESS->cpu_burst);			
+				cpu_burst = rand.myrandom(pt.cpu_burst[pid], pt.cpu_burst_mod[pid]);			
 				trace("Rand cpu_burst: %d\n", cpu_burst); 
 			}
 			
 			// compare current cpu_burst with the remaning cpu execution time
-			cpu_burst = min(cpu_burst, CURRENT_RUNNING_PROCESS->rem_cpu_time);
+			cpu_burst = min(cpu_burst, pt.rem_cpu_time[pid]);
 			
 			if (VERBOSE) {
-				TraceEventExecution(proc, evt, time_in_prev_state, cpu_burst);
+				TraceEventExecution(pid, evt, time_in_prev_state, cpu_burst);
+			}
+			if (TRACE_RECORD.is_open()) {
+				RecordEvent(pid, evt, time_in_prev_state, cpu_burst);
 			}
 			
 			//quantum preemption check
-			Event *evt;
-			trace("cpu_burst %d, scheduler quantum: %d\n", cpu_burst, sched.quantum);
-			if (cpu_burst > sched.quantum) {		
+			Event next_evt;
+			quantum = scheds[pt.cpu[pid]]->Quantum(pid);
+			trace("cpu_burst %d, scheduler quantum: %d\n", cpu_burst, quantum);
+			if (cpu_burst > quantum) {		
+				perfCount(quantum_preemptions);
 				trace("Preempt current event!\n");
 				// create an event for preemption
-				proc->rem_cpu_time -= sched.quantum;
-				proc->rem_cpu_burst = cpu_burst - sched.quantum;
-				trace("Remaining cpu_burst: %d \n", proc->rem_cpu_burst);
-				int end_time = CURRENT_TIME + sched.quantum;
-				evt = new Event(proc,
+				CPU_BUSY_TIME[pt.cpu[pid]] += quantum;
+				pt.rem_cpu_time[pid] -= quantum;
+				pt.rem_cpu_burst[pid] = cpu_burst - quantum;
+				trace("Remaining cpu_burst: %d \n", pt.rem_cpu_burst[pid]);
+				int end_time = CURRENT_TIME + quantum;
+				next_evt = Event(pid,
 								end_time,
 								STATE_RUNNING,
 								STATE_READY,
 								TRANS_TO_PREEMPT);
 			} else {
 				// create an event for blocking
-				proc->rem_cpu_time -= cpu_burst;
-				proc->rem_cpu_burst = 0; // use up all the remaining cpu burst
+				CPU_BUSY_TIME[pt.cpu[pid]] += cpu_burst;
+				pt.rem_cpu_time[pid] -= cpu_burst;
+				pt.rem_cpu_burst[pid] = 0; // use up all the remaining cpu burst
 				int end_time = CURRENT_TIME + cpu_burst;
-				evt = new Event(proc,
+				next_evt = Event(pid,
 							    end_time,
 							    STATE_RUNNING,
 							    STATE_BLOCKED,
 							    TRANS_TO_BLOCK);
 			}  
-			AddEventToEventQ(des, evt);			
+			AddEventToEventQ(des, next_evt);			
 			break;
 
 		case TRANS_TO_BLOCK:
 
 			// generate io_busrt
-			if (proc->rem_cpu_time) {
-				io_burst = rand.myrandom(proc->io_burst);
+			if (pt.rem_cpu_time[pid]) {
+				io_burst = rand.myrandom(pt.io_burst[pid], pt.io_burst_mod[pid]);
 				trace("Rand io_burst: %d\n", io_burst);
 			}			
-			proc->io_time += io_burst;
-			update_io_use(io_burst);
+			pt.io_time[pid] += io_burst;
+			if (REAL_TIME && pt.period[pid]) {
+				CompleteJob(pid);
+			}
+			if (IO_DEVICES.empty()) {
+				update_io_use(io_burst);
+			}
+			if (PROPORTIONAL_SHARE) {
+				ShareLeave(pid);
+			}
 			
 			if (VERBOSE) {
-				TraceEventExecution(proc, evt, time_in_prev_state, cpu_burst, io_burst);
+				TraceEventExecution(pid, evt, time_in_prev_state, cpu_burst, io_burst);
 			}	
+			if (TRACE_RECORD.is_open()) {
+				RecordEvent(pid, evt, time_in_prev_state, cpu_burst, io_burst);
+			}
 
-			if (proc->rem_cpu_time) {
+			if (pt.rem_cpu_time[pid] && !IO_DEVICES.empty()) {
+				RequestIO(des, pid, io_burst);
+			} else if (pt.rem_cpu_time[pid]) {
 			// create an event for when the process becomes READY again
 				int end_time = CURRENT_TIME + io_burst;
-				Event *evt = new Event(proc,
-									   end_time,
-									   STATE_BLOCKED,
-						               STATE_READY,
-									   TRANS_TO_READY);
-				AddEventToEventQ(des, evt);			
+				AddEventToEventQ(des, Event(pid,
+											end_time,
+											STATE_BLOCKED,
+											STATE_READY,
+											TRANS_TO_READY));			
 			} else {
 				// process is done
 				trace("Process is done. Mark finish time for the process.\n");
-				proc->finish_time = CURRENT_TIME;
+				pt.finish_time[pid] = CURRENT_TIME;
+				if (RECORD_LATENCY) {
+					TURNAROUND_HIST.Record(CURRENT_TIME - pt.arrival_time[pid]);
+				}
 			}	
-			CURRENT_RUNNING_PROCESS = nullptr;
+			RUNNING_PROCESS[pt.cpu[pid]] = NO_PID;
 			CALL_SCHEDULER = true;
 			break;
 		}
-		delete evt;
-		evt = nullptr;
-	
+		perfStop(PERF_PHASE_EVENT, event_start);
+
+		// a time step ends once every event with its time stamp, including
+		// the ones just added, is handled: then one scheduler call for all
+		if (des.GetNextEventTime() == CURRENT_TIME) {
+			continue;
+		}
+		perfCount(time_steps);
 		if (CALL_SCHEDULER) {
-			if (des.GetNextEventTime() == CURRENT_TIME) {
-				continue; // process next event from Event queue
-			}						
 			CALL_SCHEDULER = false;
-			if (CURRENT_RUNNING_PROCESS == nullptr) {
+			perfStart(schedule_start);
+			int queued = 0;
+			for (cpu = 0; cpu < NUM_CPUS; cpu++) {
+				queued += scheds[cpu]->ReadyCount();
+			}
+			for (cpu = 0; cpu < NUM_CPUS; cpu++) {
+				if (RUNNING_PROCESS[cpu] != NO_PID) {
+					continue;
+				}
 				if (SHOW_SCHED_READY_QUEUE) {
-                    sched.ShowReadyQueue();
+					if (NUM_CPUS > 1) {
+						TRACE_OUT << "CPU" << cpu << " ";
+					}
+                    scheds[cpu]->ShowReadyQueue();
                 }
-				CURRENT_RUNNING_PROCESS = sched.GetNextProcess();
-				if (CURRENT_RUNNING_PROCESS == nullptr) {
+				perfCount(scheduler_calls);
+				int next = scheds[cpu]->GetNextProcess();
+				if (next == NO_PID) {
+					next = StealProcess(scheds, cpu, queued);
+				}
+				if (next == NO_PID) {
 					continue;
 				}
-				trace("Process %d: CPU Waiting Time (time in ready state): %d\n", CURRENT_RUNNING_PROCESS->pid, CURRENT_TIME - CURRENT_RUNNING_PROCESS->state_time_stamp);
-				CURRENT_RUNNING_PROCESS->wait_time += CURRENT_TIME - CURRENT_RUNNING_PROCESS->state_time_stamp;
-				trace("Process %d: Total CPU Waiting Time: %d\n", CURRENT_RUNNING_PROCESS->pid, CURRENT_RUNNING_PROCESS->wait_time);
+				queued--;
+				if (pt.cpu[next] >= 0 && pt.cpu[next] != cpu) {
+					CPU_MIGRATIONS[cpu]++;
+				}
+				if (RECORD_LATENCY) {
+					WAIT_HIST.Record(CURRENT_TIME - pt.state_time_stamp[next]);
+					if (pt.cpu[next] < 0) {
+						RESPONSE_HIST.Record(CURRENT_TIME - pt.arrival_time[next]);
+					}
+				}
+				pt.cpu[next] = cpu;
+				RUNNING_PROCESS[cpu] = next;
+				perfCount(context_switches);
+				trace("Process %d: CPU Waiting Time (time in ready state): %d\n", next, CURRENT_TIME - pt.state_time_stamp[next]);
+				pt.wait_time[next] += CURRENT_TIME - pt.state_time_stamp[next];
+				trace("Process %d: Total CPU Waiting Time: %d\n", next, pt.wait_time[next]);
 				// create event tom make this process runnable for same time
-				Event *evt = new Event(CURRENT_RUNNING_PROCESS,
-                                     CURRENT_TIME,
-                                     STATE_READY,
-                                     STATE_RUNNING,
-                                     TRANS_TO_RUN);
-               	AddEventToEventQ(des, evt);
+				AddEventToEventQ(des, Event(next,
+											CURRENT_TIME,
+											STATE_READY,
+											STATE_RUNNING,
+											TRANS_TO_RUN));
 			}
+			perfStop(PERF_PHASE_SCHEDULE, schedule_start);
+		}
+
+		if (TELEMETRY) {
+			PublishTelemetry(scheds);
 		}
+		CheckpointIfDue(des, base_scheds, rand);
+	}
+}
+
+// picks the simulation() instantiation once, from the scheduler class
+void RunSimulation(DES &des, vector<Scheduler*> &scheds, RandGenerator &rand) {
+#if GENERIC_SIMULATION
+	simulation<Scheduler>(des, scheds, rand);
+#else
+	Scheduler *sched = scheds[0];
+	if (dynamic_cast<FCFS_scheduler*>(sched)) {
+		simulation<FCFS_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<LCFS_scheduler*>(sched)) {
+		simulation<LCFS_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<SRTF_scheduler*>(sched)) {
+		simulation<SRTF_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<PRIO_scheduler*>(sched)) {
+		simulation<PRIO_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<CFS_scheduler*>(sched)) {
+		simulation<CFS_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<MLFQ_scheduler*>(sched)) {
+		simulation<MLFQ_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<LOTTERY_scheduler*>(sched)) {
+		simulation<LOTTERY_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<STRIDE_scheduler*>(sched)) {
+		simulation<STRIDE_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<EDF_scheduler*>(sched)) {
+		simulation<EDF_scheduler>(des, scheds, rand);
+	} else if (dynamic_cast<RM_scheduler*>(sched)) {
+		simulation<RM_scheduler>(des, scheds, rand);
+	} else {
+		simulation<Scheduler>(des, scheds, rand);
 	}
+#endif
+}
+
+void PrintHistogram(const char *name, Histogram &hist) {
+	cout << name << ": " << hist.Count() << " "
+		 << hist.Percentile(50) << " "
+		 << hist.Percentile(90) << " "
+		 << hist.Percentile(99) << " "
+		 << hist.Percentile(99.9) << " "
+		 << hist.Max() << endl;
 }
 
-void statistics(Scheduler *sched, vector<Process> &processes) { 
-	int last_FT = 0; // Finish time of the last event
+// the numbers of the SUM line
+struct Summary {
+	int last_FT; // Finish time of the last event
 	double cpu_util, io_util, avg_TT, avg_cpu_wait, throughput;
-	double count = processes.size();
-	
+};
+
+// the final statistics work on chunks of this many processes, in parallel
+const int STATISTICS_CHUNK = 1 << 16;
+
+// f(chunk, first pid, end pid) for every chunk of n processes, on up to one
+// thread per core
+template <class F>
+void ForEachChunk(int n, F f) {
+	int chunks = (n + STATISTICS_CHUNK - 1) / STATISTICS_CHUNK;
+	int workers = min(chunks, (int)max(1u, thread::hardware_concurrency()));
+	atomic<int> next{0};
+	auto work = [&]() {
+		for (int c = next++; c < chunks; c = next++) {
+			f(c, c * STATISTICS_CHUNK, min(n, (c + 1) * STATISTICS_CHUNK));
+		}
+	};
+	vector<thread> threads;
+	for (int w = 1; w < workers; w++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (thread &t: threads) {
+		t.join();
+	}
+}
+
+// v right aligned in width characters, as cout << setw(width) << setfill(fill) << v
+char* PutPadded(char *out, long v, int width, char fill) {
+	char digits[24];
+	char *p = digits + sizeof(digits);
+	unsigned long u = v < 0 ? -(unsigned long)v : v;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	if (v < 0) {
+		*--p = '-';
+	}
+	int len = digits + sizeof(digits) - p;
+	for (; width > len; width--) {
+		*out++ = fill;
+	}
+	memcpy(out, p, len);
+	return out + len;
+}
+
+Summary Summarize(const ProcessTable &pt) {
+	// per chunk sums, exact in integers, so the result does not depend on
+	// how the processes are split
+	struct Partial {
+		int last_FT = 0;
+		long cpu_time = 0, turnaround = 0, cpu_wait = 0;
+	};
+	int chunks = (pt.Size() + STATISTICS_CHUNK - 1) / STATISTICS_CHUNK;
+	vector<Partial> partials(chunks);
+	ForEachChunk(pt.Size(), [&](int c, int from, int to) {
+		Partial &p = partials[c];
+		for (int pid = from; pid < to; pid++) {
+			p.last_FT = max(p.last_FT, pt.finish_time[pid]);
+			p.cpu_time += pt.total_cpu_time[pid];
+			p.turnaround += pt.finish_time[pid] - pt.arrival_time[pid];
+			p.cpu_wait += pt.wait_time[pid];
+		}
+	});
+	Partial total;
+	for (Partial &p: partials) {
+		total.last_FT = max(total.last_FT, p.last_FT);
+		total.cpu_time += p.cpu_time;
+		total.turnaround += p.turnaround;
+		total.cpu_wait += p.cpu_wait;
+	}
+
+	int last_FT = total.last_FT;
+	double count = pt.Size();
+	double cpu_util = (double)total.cpu_time / last_FT / NUM_CPUS * 100;
+	double io_util = (double)IO_USE / last_FT * 100;
+	trace("io_use: %d, io_util: %f\n", IO_USE, io_util);
+	double avg_TT = total.turnaround / count;
+	double avg_cpu_wait = total.cpu_wait / count;
+	double throughput = 100 * count / last_FT;
+	return {last_FT, cpu_util, io_util, avg_TT, avg_cpu_wait, throughput};
+}
+
+void PrintSummary(const Summary &sum) {
+	cout << sum.last_FT << " "
+		 << fixed << setprecision(2) << sum.cpu_util << " "
+		 << fixed << setprecision(2) << sum.io_util << " "
+	     // Average turnaround time among processes
+		 << fixed << setprecision(2) << sum.avg_TT  << " "
+		 << fixed << setprecision(2) << sum.avg_cpu_wait << " "
+		 << fixed << setprecision(3) << sum.throughput << endl;
+}
+
+void PrintSchedulerName(Scheduler *sched) {
 	cout << sched->sched_type;
-	if (sched->sched_type == "RR" || sched->sched_type == "PRIO" || sched->sched_type == "PREPRIO") {
+	if (sched->sched_type == "RR" || sched->sched_type == "PRIO" || sched->sched_type == "PREPRIO" || sched->sched_type == "CFS" || sched->sched_type == "MLFQ"
+		|| sched->sched_type == "LOTTERY" || sched->sched_type == "STRIDE") {
 		cout << " " << sched->quantum;
 	}
 	cout << endl;
+}
 
-	for (auto proc: processes) { 
-		cout << setw(4) << setfill('0') << proc.pid << ": "
-			 << setw(4) << setfill(' ') << proc.arrival_time << " "
-			 << setw(4) << proc.total_cpu_time << " "
-			 << setw(4) << proc.cpu_burst << " "
-			 << setw(4) << proc.io_burst << " "
-			 << setw(1) << proc.static_prio << " | ";
-
-		cout << setw(5) << proc.finish_time << " "
-			 << setw(5) << proc.finish_time - proc.arrival_time << " "
-			 << setw(5) << proc.io_time << " "
-			 << setw(5) << proc.wait_time << endl;
-		last_FT = max(last_FT, proc.finish_time);
-		cpu_util += proc.total_cpu_time;
-	    avg_TT += proc.finish_time - proc.arrival_time;
-		avg_cpu_wait += proc.wait_time;
-	}    
-	
-	cpu_util = cpu_util / last_FT * 100;
-	io_util += (double)IO_USE / last_FT * 100;
-	trace("io_use: %d, io_util: %f\n", IO_USE, io_util);
-	avg_TT /= count;
-	avg_cpu_wait /= count;
-	throughput = 100 *  count / last_FT;
-	cout << "SUM: " 
-		 << last_FT << " "
-		 << fixed << setprecision(2) << cpu_util << " "
-		 << fixed << setprecision(2) << io_util << " "
-	     // Average turnaround time among processes
-		 << fixed << setprecision(2) << avg_TT  << " "
-		 << fixed << setprecision(2) << avg_cpu_wait << " "
-		 << fixed << setprecision(3) << throughput << endl;
+void statistics(Scheduler *sched, ProcessTable &pt) { 
+	double count = pt.Size();
+	PrintSchedulerName(sched);
+
+	// one row per process, formatted chunk by chunk in parallel and written
+	// in pid order
+	int chunks = (pt.Size() + STATISTICS_CHUNK - 1) / STATISTICS_CHUNK;
+	vector<string> rows(chunks);
+	ForEachChunk(pt.Size(), [&](int c, int from, int to) {
+		char line[256];
+		rows[c].reserve((to - from) * 48);
+		for (int pid = from; pid < to; pid++) {
+			char *p = PutPadded(line, pid, 4, '0');
+			*p++ = ':';
+			for (int v: {pt.arrival_time[pid], pt.total_cpu_time[pid], pt.cpu_burst[pid], pt.io_burst[pid]}) {
+				*p++ = ' ';
+				p = PutPadded(p, v, 4, ' ');
+			}
+			*p++ = ' ';
+			p = PutPadded(p, pt.static_prio[pid], 1, ' ');
+			*p++ = ' ';
+			*p++ = '|';
+			for (int v: {pt.finish_time[pid], pt.finish_time[pid] - pt.arrival_time[pid], pt.io_time[pid], pt.wait_time[pid]}) {
+				*p++ = ' ';
+				p = PutPadded(p, v, 5, ' ');
+			}
+			*p++ = '\n';
+			rows[c].append(line, p - line);
+		}
+	});
+	for (string &chunk: rows) {
+		cout.write(chunk.data(), chunk.size());
+	}
+
+	Summary sum = Summarize(pt);
+	int last_FT = sum.last_FT;
+	cout << "SUM: ";
+	PrintSummary(sum);
+
+	if (NUM_CPUS > 1) {
+		// CPU <id>: utilization | migrations
+		for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+			cout << "CPU " << cpu << ": "
+				 << fixed << setprecision(2) << (double)CPU_BUSY_TIME[cpu] / last_FT * 100 << " "
+				 << CPU_MIGRATIONS[cpu] << endl;
+		}
+	}
+
+	// IO <device>: utilization | requests | average queueing delay | max queue length
+	for (int d = 0; d < (int)IO_DEVICES.size(); d++) {
+		IODevice &dev = IO_DEVICES[d];
+		cout << "IO " << d << ": "
+			 << fixed << setprecision(2) << (double)dev.busy_time / last_FT * 100 << " "
+			 << dev.requests << " "
+			 << fixed << setprecision(2) << (dev.requests ? (double)dev.queue_delay / dev.requests : 0) << " "
+			 << dev.max_queue << endl;
+	}
+
+	if (PROPORTIONAL_SHARE) {
+		// SHARE <pid>: tickets | entitled cpu time | received cpu time | error %
+		double sum_error = 0, max_error = 0;
+		for (int pid = 0; pid < pt.Size(); pid++) {
+			double entitled = pt.entitled_cpu_time[pid];
+			int received = pt.total_cpu_time[pid] - pt.rem_cpu_time[pid];
+			double error = entitled > 0 ? (received - entitled) / entitled * 100 : 0;
+			sum_error += abs(error);
+			max_error = max(max_error, abs(error));
+			cout << "SHARE " << setw(4) << setfill('0') << pid << ": "
+				 << setfill(' ') << pt.tickets[pid] << " "
+				 << fixed << setprecision(2) << entitled << " "
+				 << received << " "
+				 << fixed << setprecision(2) << error << endl;
+		}
+		// mean | max absolute error %
+		cout << "SHARE ERROR: "
+			 << fixed << setprecision(2) << sum_error / count << " "
+			 << fixed << setprecision(2) << max_error << endl;
+	}
+
+	if (REAL_TIME) {
+		// DEADLINE: jobs | missed jobs | missed %
+		cout << "DEADLINE: " << DEADLINE_JOBS << " " << DEADLINE_MISSES << " "
+			 << fixed << setprecision(2) << (DEADLINE_JOBS ? 100.0 * DEADLINE_MISSES / DEADLINE_JOBS : 0) << endl;
+		// LATENESS: count | p50 | p90 | p99 | p99.9 | max, of the missed jobs
+		PrintHistogram("LATENESS", LATENESS_HIST);
+	}
+
+	if (EXTENDED_STATISTICS) {
+		// <metric>: count | p50 | p90 | p99 | p99.9 | max
+		PrintHistogram("TURNAROUND", TURNAROUND_HIST);
+		PrintHistogram("WAIT", WAIT_HIST);
+		PrintHistogram("RESPONSE", RESPONSE_HIST);
+		// EVENTS: dispatched events
+		cout << "EVENTS: " << EVENTS_DISPATCHED << endl;
+	}
+}
+
+/*
+ * Monte Carlo (-m): the same workload simulated under independent random
+ * streams, one forked replica per seed and at most one replica per core at
+ * a time. Replica i uses seed + i, so -m 1:<seed + i> reruns it alone.
+ * Prints the SUM numbers of every replica, their mean and the half-width of
+ * the 95% confidence interval (Student's t).
+ */
+const double T_95[] = {0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042}; // by degrees of freedom
+const double Z_95 = 1.960; // beyond 30 degrees of freedom
+
+void RunReplica(vector<Scheduler*> &scheds, RandGenerator &rand, unsigned long seed, int fd) {
+	trace("Replica with seed %lu\n", seed);
+	rand.Seed(seed);
+	DES des(PROCESS_TABLE);
+	RunSimulation(des, scheds, rand);
+	Summary sum = Summarize(PROCESS_TABLE);
+	if (write(fd, &sum, sizeof(sum)) != sizeof(sum)) {
+		_exit(1);
+	}
+}
+
+int MonteCarlo(vector<Scheduler*> &scheds, RandGenerator &rand) {
+	int cores = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+	vector<Summary> sums(MONTE_CARLO);
+	vector<int> fds(MONTE_CARLO);
+	vector<pid_t> children(MONTE_CARLO);
+
+	// read a replica's summary and reap it
+	auto collect = [&](int k) {
+		bool ok = read(fds[k], &sums[k], sizeof(Summary)) == sizeof(Summary);
+		int status = 0;
+		close(fds[k]);
+		waitpid(children[k], &status, 0);
+		if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			cerr << "Monte Carlo replica with seed " << MONTE_CARLO_SEED + k << " failed" << endl;
+			exit(1);
+		}
+	};
+
+	cout.flush();
+	for (int i = 0; i < MONTE_CARLO; i++) {
+		if (i >= cores) {
+			collect(i - cores);
+		}
+		int pipefd[2];
+		if (pipe(pipefd) != 0 || (children[i] = fork()) < 0) {
+			cerr << "Can not start Monte Carlo replica" << endl;
+			exit(1);
+		}
+		if (children[i] == 0) {
+			close(pipefd[0]);
+			RunReplica(scheds, rand, MONTE_CARLO_SEED + i, pipefd[1]);
+			_exit(0);
+		}
+		close(pipefd[1]);
+		fds[i] = pipefd[0];
+	}
+	for (int i = max(0, MONTE_CARLO - cores); i < MONTE_CARLO; i++) {
+		collect(i);
+	}
+
+	PrintSchedulerName(scheds[0]);
+	const int nfields = 6;
+	double mean[nfields] = {}, var[nfields] = {};
+	for (int i = 0; i < MONTE_CARLO; i++) {
+		cout << "MC " << MONTE_CARLO_SEED + i << ": ";
+		PrintSummary(sums[i]);
+		double vals[nfields] = {(double)sums[i].last_FT, sums[i].cpu_util, sums[i].io_util,
+								sums[i].avg_TT, sums[i].avg_cpu_wait, sums[i].throughput};
+		for (int f = 0; f < nfields; f++) {
+			// Welford's running mean and variance
+			double delta = vals[f] - mean[f];
+			mean[f] += delta / (i + 1);
+			var[f] += delta * (vals[f] - mean[f]);
+		}
+	}
+	int df = MONTE_CARLO - 1;
+	double t = df <= 30 ? T_95[df] : Z_95;
+	// MC MEAN / CI95: the six SUM numbers
+	cout << "MC MEAN:";
+	for (int f = 0; f < nfields; f++) {
+		cout << " " << fixed << setprecision(f == nfields - 1 ? 3 : 2) << mean[f];
+	}
+	cout << endl << "MC CI95:";
+	for (int f = 0; f < nfields; f++) {
+		double half = df > 0 ? t * sqrt(var[f] / df / MONTE_CARLO) : 0;
+		cout << " " << fixed << setprecision(f == nfields - 1 ? 3 : 2) << half;
+	}
+	cout << endl;
+	return 0;
+}
+
+/*
+ * Coupled hosts (-H), see Migration: the coordinator. Each round it grants
+ * the window [T, T + latency), T the earliest event or migration of any
+ * host, to the hosts with something to do before its end, at most
+ * HOST_WORKERS of them at a time, and routes the migrations they report.
+ */
+void RunHost(vector<Scheduler*> &scheds, RandGenerator &rand, int host) {
+	HOST = host;
+	trace("Host %d starts\n", HOST);
+	ProcessTable all = move(PROCESS_TABLE);
+	PROCESS_TABLE = ProcessTable();
+	for (int pid = HOST; pid < all.Size(); pid += HOSTS) {
+		PROCESS_TABLE.Add(all.arrival_time[pid], all.total_cpu_time[pid], all.cpu_burst[pid],
+						  all.io_burst[pid], all.static_prio[pid], all.tickets[pid], all.period[pid], all.deadline[pid]);
+	}
+	DES des(PROCESS_TABLE);
+	RunSimulation(des, scheds, rand);
+
+	ProcessTable &pt = PROCESS_TABLE;
+	HostResult result = {CURRENT_TIME, 0, IO_USE, 0, 0, 0, MIGRATIONS_RECEIVED, MIGRATIONS_SENT};
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		result.cpu_busy += CPU_BUSY_TIME[cpu];
+	}
+	for (int pid = 0; pid < pt.Size(); pid++) {
+		if (!pt.migrated[pid]) {
+			result.finished++;
+			result.sum_TT += pt.finish_time[pid] - pt.arrival_time[pid];
+			result.sum_cpu_wait += pt.wait_time[pid];
+		}
+	}
+	if (!WriteAll(HOST_REPORTS, &result, sizeof(result))) {
+		_exit(1);
+	}
+}
+
+Summary HostSummary(int last_FT, long cpu_busy, long io_use, long finished, double sum_TT, double sum_cpu_wait, int hosts) {
+	double count = max(finished, 1L);
+	return {last_FT,
+			(double)cpu_busy / last_FT / NUM_CPUS / hosts * 100,
+			(double)io_use / last_FT / hosts * 100,
+			sum_TT / count,
+			sum_cpu_wait / count,
+			100.0 * finished / last_FT};
+}
+
+int MultiHost(vector<Scheduler*> &scheds, RandGenerator &rand) {
+	int workers = HOST_WORKERS ? HOST_WORKERS : max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+	vector<int> grants(HOSTS), reports(HOSTS);
+	vector<pid_t> children(HOSTS);
+
+	cout.flush();
+	for (int h = 0; h < HOSTS; h++) {
+		int grant_pipe[2], report_pipe[2];
+		if (pipe(grant_pipe) != 0 || pipe(report_pipe) != 0 || (children[h] = fork()) < 0) {
+			cerr << "Can not start host " << h << endl;
+			exit(1);
+		}
+		if (children[h] == 0) {
+			for (int other = 0; other < h; other++) {
+				close(grants[other]);
+				close(reports[other]);
+			}
+			close(grant_pipe[1]);
+			close(report_pipe[0]);
+			HOST_GRANTS = grant_pipe[0];
+			HOST_REPORTS = report_pipe[1];
+			RunHost(scheds, rand, h);
+			_exit(0);
+		}
+		close(grant_pipe[0]);
+		close(report_pipe[1]);
+		grants[h] = grant_pipe[1];
+		reports[h] = report_pipe[0];
+	}
+
+	vector<int> next_time(HOSTS);
+	vector<vector<Migration>> undelivered(HOSTS); // by destination host
+	long migrations = 0;
+	long windows = 0;
+	auto fail = [](int h) {
+		cerr << "Host " << h << " failed" << endl;
+		exit(1);
+	};
+	auto collect = [&](int h) {
+		WindowReport report;
+		if (!ReadAll(reports[h], &report, sizeof(report))) {
+			fail(h);
+		}
+		next_time[h] = report.next_time;
+		for (int i = 0; i < report.migrations; i++) {
+			Migration m;
+			if (!ReadAll(reports[h], &m, sizeof(m))) {
+				fail(h);
+			}
+			undelivered[m.dst_host].push_back(m);
+			migrations++;
+		}
+	};
+	// the hosts report their first event before the first window
+	for (int h = 0; h < HOSTS; h++) {
+		collect(h);
+	}
+	while (true) {
+		int start = -1;
+		for (int h = 0; h < HOSTS; h++) {
+			if (next_time[h] >= 0 && (start < 0 || next_time[h] < start)) {
+				start = next_time[h];
+			}
+			for (Migration &m: undelivered[h]) {
+				if (start < 0 || m.arrive_time < start) {
+					start = m.arrive_time;
+				}
+			}
+		}
+		if (start < 0) {
+			break;
+		}
+		int window_end = start + MIGRATION_LATENCY;
+		windows++;
+		trace("Window %ld: [%d, %d)\n", windows, start, window_end);
+
+		// hosts without events or arrivals in the window sit it out
+		vector<int> active;
+		for (int h = 0; h < HOSTS; h++) {
+			bool arrivals = false;
+			for (Migration &m: undelivered[h]) {
+				arrivals |= m.arrive_time < window_end;
+			}
+			if (arrivals || (next_time[h] >= 0 && next_time[h] < window_end)) {
+				active.push_back(h);
+			}
+		}
+		for (int i = 0; i < (int)active.size(); i++) {
+			if (i >= workers) {
+				collect(active[i - workers]);
+			}
+			int h = active[i];
+			WindowGrant grant = {window_end, (int)undelivered[h].size()};
+			if (!WriteAll(grants[h], &grant, sizeof(grant))
+				|| !WriteAll(grants[h], undelivered[h].data(), undelivered[h].size() * sizeof(Migration))) {
+				fail(h);
+			}
+			undelivered[h].clear();
+		}
+		for (int i = max(0, (int)active.size() - workers); i < (int)active.size(); i++) {
+			collect(active[i]);
+		}
+	}
+
+	vector<HostResult> results(HOSTS);
+	for (int h = 0; h < HOSTS; h++) {
+		WindowGrant done = {-1, 0};
+		int status = 0;
+		if (!WriteAll(grants[h], &done, sizeof(done)) || !ReadAll(reports[h], &results[h], sizeof(HostResult))) {
+			fail(h);
+		}
+		close(grants[h]);
+		close(reports[h]);
+		waitpid(children[h], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fail(h);
+		}
+	}
+
+	PrintSchedulerName(scheds[0]);
+	HostResult total = {};
+	for (int h = 0; h < HOSTS; h++) {
+		HostResult &r = results[h];
+		// HOST <h>: the six SUM numbers of the host | migrated in | migrated out
+		cout << "HOST " << h << ": ";
+		Summary sum = HostSummary(r.last_time, r.cpu_busy, r.io_use, r.finished, r.sum_TT, r.sum_cpu_wait, 1);
+		cout << sum.last_FT << " "
+			 << fixed << setprecision(2) << sum.cpu_util << " "
+			 << fixed << setprecision(2) << sum.io_util << " "
+			 << fixed << setprecision(2) << sum.avg_TT << " "
+			 << fixed << setprecision(2) << sum.avg_cpu_wait << " "
+			 << fixed << setprecision(3) << sum.throughput << " | "
+			 << r.migrated_in << " " << r.migrated_out << endl;
+		total.last_time = max(total.last_time, r.last_time);
+		total.cpu_busy += r.cpu_busy;
+		total.io_use += r.io_use;
+		total.finished += r.finished;
+		total.sum_TT += r.sum_TT;
+		total.sum_cpu_wait += r.sum_cpu_wait;
+	}
+	// HOST SUM: the SUM numbers over all hosts, utilizations per host
+	cout << "HOST SUM: ";
+	PrintSummary(HostSummary(total.last_time, total.cpu_busy, total.io_use, total.finished,
+							 total.sum_TT, total.sum_cpu_wait, HOSTS));
+	// HOST WINDOWS: synchronization rounds | migrations
+	cout << "HOST WINDOWS: " << windows << " " << migrations << endl;
+	return 0;
+}
+
+Scheduler* CreateScheduler(char sched_type, int quantum, int maxprio, int extra_param, RandGenerator &rand) {
+	bool prio_preempt = false;
+	switch (sched_type) {
+		case 'F':
+			trace("%s\n", "Scheduler Type: FCFS"); 
+			return new FCFS_scheduler();
+		case 'L':
+			trace("%s\n", "Initializing LCFS"); 
+			return new LCFS_scheduler();
+		case 'S':
+			trace("%s\n", "Initializing SRTF"); 
+			return new SRTF_scheduler();
+		case 'T':
+			trace("%s\n", "Initializing PSRTF (Preemptive SRTF)"); 
+			return new SRTF_scheduler(true);
+		case 'R':
+			trace("Initializing RR (Round Robin) with quantum %d\n", quantum); 
+			return new FCFS_scheduler("RR", quantum);
+		case 'P':
+			trace("Initializing PRIO (Priority Scheduler) with quantum %d, maxprio %d\n", quantum, maxprio); 
+			return new PRIO_scheduler(quantum, maxprio);
+		case 'E':
+			trace("%s\n", "Initializing PREPRIIO (Preemptive Priority Scheduler)"); 
+			prio_preempt = true;
+			return new PRIO_scheduler(quantum, maxprio, prio_preempt);
+		case 'C':
+			trace("Initializing CFS with target latency %d, min granularity %d\n", quantum, extra_param);
+			return new CFS_scheduler(quantum, extra_param);
+		case 'M':
+			trace("Initializing MLFQ with quantum %d, %d levels, boost period %d\n", quantum, maxprio, extra_param);
+			return new MLFQ_scheduler(quantum, maxprio, extra_param);
+		case 'O':
+			trace("Initializing LOTTERY with quantum %d\n", quantum);
+			return new LOTTERY_scheduler(quantum, [&rand](long n) { return rand.RandomBelow(n); });
+		case 'D':
+			trace("Initializing STRIDE with quantum %d\n", quantum);
+			return new STRIDE_scheduler(quantum);
+		case 'X':
+			trace("%s\n", "Initializing EDF");
+			return new EDF_scheduler();
+		case 'Y':
+			trace("%s\n", "Initializing RM");
+			return new RM_scheduler();
+	}
+	return nullptr;
+}
+
+/*
+ * Autotuning (-o): searches quantum 1..<quantum> and maxprio 1..<maxprio> of
+ * the -s spec for the lowest average turnaround (tt), the lowest p99 ready
+ * queue wait (wait) or the highest throughput (tp). One golden-section search
+ * over the quantum per maxprio (RR: only the given maxprio) that keeps the
+ * surviving interior point, so a round adds one new candidate per search,
+ * after a first round that also simulates both bounds of the range;
+ * every round the candidates of all searches are simulated at once, one forked
+ * run per candidate on the loaded workload, at most <workers> of -o (default:
+ * one per core) at a time. Prints the best candidate and the Pareto front of
+ * all simulated ones over the three objectives.
+ */
+struct TuneResult {
+	Summary sum;
+	long p99_wait;
+};
+
+const double GOLDEN_RATIO = 1.6180339887;
+
+void RunTuneCandidate(char sched_type, int quantum, int maxprio, RandGenerator &rand, int fd) {
+	trace("Tune candidate quantum %d, maxprio %d\n", quantum, maxprio);
+	ProcessTable &pt = PROCESS_TABLE;
+	// the priorities a run with this maxprio would have drawn
+	for (int pid = 0; pid < pt.Size(); pid++) {
+		pt.static_prio[pid] = rand.RandomAt(pid, maxprio);
+		pt.dynamic_prio[pid] = pt.static_prio[pid] - 1;
+	}
+	vector<Scheduler*> scheds;
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		scheds.push_back(CreateScheduler(sched_type, quantum, maxprio, 0, rand));
+	}
+	RECORD_LATENCY = true;
+	DES des(pt);
+	RunSimulation(des, scheds, rand);
+	TuneResult res = {Summarize(pt), WAIT_HIST.Percentile(99)};
+	if (write(fd, &res, sizeof(res)) != sizeof(res)) {
+		_exit(1);
+	}
+}
+
+// simulates the candidates {quantum, maxprio} not simulated yet
+void RunTuneBatch(char sched_type, vector<pair<int, int>> candidates, map<pair<int, int>, TuneResult> &results,
+				  RandGenerator &rand) {
+	sort(candidates.begin(), candidates.end());
+	candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+	candidates.erase(remove_if(candidates.begin(), candidates.end(),
+							   [&](const pair<int, int> &c) { return results.count(c); }), candidates.end());
+	int workers = TUNE_WORKERS ? TUNE_WORKERS : max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+	int n = candidates.size();
+	vector<int> fds(n);
+	vector<pid_t> children(n);
+
+	auto collect = [&](int k) {
+		TuneResult res;
+		bool ok = read(fds[k], &res, sizeof(res)) == sizeof(res);
+		int status = 0;
+		close(fds[k]);
+		waitpid(children[k], &status, 0);
+		if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			cerr << "Tune run with quantum " << candidates[k].first << ", maxprio " << candidates[k].second
+				 << " failed" << endl;
+			exit(1);
+		}
+		results[candidates[k]] = res;
+	};
+
+	cout.flush();
+	for (int i = 0; i < n; i++) {
+		if (i >= workers) {
+			collect(i - workers);
+		}
+		int pipefd[2];
+		if (pipe(pipefd) != 0 || (children[i] = fork()) < 0) {
+			cerr << "Can not start tune run" << endl;
+			exit(1);
+		}
+		if (children[i] == 0) {
+			close(pipefd[0]);
+			RunTuneCandidate(sched_type, candidates[i].first, candidates[i].second, rand, pipefd[1]);
+			_exit(0);
+		}
+		close(pipefd[1]);
+		fds[i] = pipefd[0];
+	}
+	for (int i = max(0, n - workers); i < n; i++) {
+		collect(i);
+	}
+}
+
+void PrintTuneResult(const char *label, const pair<int, int> &candidate, const TuneResult &res) {
+	cout << label << " " << candidate.first << ":" << candidate.second << ": " << res.p99_wait << " | ";
+	PrintSummary(res.sum);
+}
+
+int Autotune(vector<Scheduler*> &scheds, char sched_type, int max_quantum, int max_maxprio, RandGenerator &rand) {
+	auto objective = [&](const TuneResult &res) {
+		return TUNE_OBJECTIVE == "tt" ? res.sum.avg_TT
+			: TUNE_OBJECTIVE == "wait" ? (double)res.p99_wait : -res.sum.throughput;
+	};
+	map<pair<int, int>, TuneResult> results; // by {quantum, maxprio}
+
+	// the best quantum of maxprio lies in [lo, hi], probed at lo < c < d < hi;
+	// rounding the golden step keeps c < d on intervals longer than 4
+	struct Search {
+		int maxprio, lo, hi, c, d;
+	};
+	auto golden_step = [](const Search &s) { return (int)lround((s.hi - s.lo) / GOLDEN_RATIO); };
+	auto place = [&](Search &s) {
+		s.c = s.hi - golden_step(s);
+		s.d = s.lo + golden_step(s);
+	};
+	vector<Search> searches;
+	for (int m = sched_type == 'R' ? max_maxprio : 1; m <= max_maxprio; m++) {
+		searches.push_back({m, 1, max_quantum, 0, 0});
+		place(searches.back());
+	}
+	int rounds = 0;
+	while (!searches.empty()) {
+		rounds++;
+		vector<pair<int, int>> candidates;
+		for (Search &s: searches) {
+			if (rounds == 1) {
+				// the objective is often monotone in the quantum, BEST picks a bound then
+				candidates.push_back({s.lo, s.maxprio});
+				candidates.push_back({s.hi, s.maxprio});
+			}
+			if (s.hi - s.lo <= 4) {
+				for (int q = s.lo; q <= s.hi; q++) {
+					candidates.push_back({q, s.maxprio});
+				}
+			} else {
+				// one of them is the survivor of the last round, simulated already
+				candidates.push_back({s.c, s.maxprio});
+				candidates.push_back({s.d, s.maxprio});
+			}
+		}
+		RunTuneBatch(sched_type, candidates, results, rand);
+		vector<Search> narrowed;
+		for (Search s: searches) {
+			if (s.hi - s.lo <= 4) {
+				continue;
+			}
+			if (objective(results[{s.c, s.maxprio}]) <= objective(results[{s.d, s.maxprio}])) {
+				// c survives as the new d
+				s.hi = s.d;
+				s.d = s.c;
+				s.c = s.hi - golden_step(s);
+			} else {
+				// d survives as the new c
+				s.lo = s.c;
+				s.c = s.d;
+				s.d = s.lo + golden_step(s);
+			}
+			// integer rounding can push the new point past the survivor
+			if (!(s.lo < s.c && s.c < s.d && s.d < s.hi)) {
+				place(s);
+			}
+			narrowed.push_back(s);
+		}
+		searches = narrowed;
+	}
+
+	// TUNE: scheduler objective | simulations | rounds
+	cout << "TUNE " << scheds[0]->sched_type << " " << TUNE_OBJECTIVE << ": "
+		 << results.size() << " " << rounds << endl;
+	auto best = results.begin();
+	for (auto it = results.begin(); it != results.end(); it++) {
+		if (objective(it->second) < objective(best->second)) {
+			best = it;
+		}
+	}
+	// <quantum>:<maxprio>: p99 wait | the six SUM numbers
+	PrintTuneResult("BEST", best->first, best->second);
+	for (auto &a: results) {
+		bool dominated = false;
+		for (auto &b: results) {
+			const TuneResult &x = a.second, &y = b.second;
+			if (y.sum.avg_TT <= x.sum.avg_TT && y.p99_wait <= x.p99_wait && y.sum.throughput >= x.sum.throughput
+				&& (y.sum.avg_TT < x.sum.avg_TT || y.p99_wait < x.p99_wait || y.sum.throughput > x.sum.throughput)) {
+				dominated = true;
+				break;
+			}
+		}
+		if (!dominated) {
+			PrintTuneResult("PARETO", a.first, a.second);
+		}
+	}
+	return 0;
 }
 
 int main(int argc, char *argv[]){
 	// parse option arguments
 	char c;
-	char sched_type[] = {'F'};
+	char sched_type[2] = {'F'}; // %1s also stores the terminating nul
 	int quantum = 0;
 	int maxprio = 4; // default
+	int extra_param = 0; // CFS min granularity, MLFQ boost period
 	opterr = 0;
-	while ((c = getopt(argc, argv, "vteps:")) != -1) {
+	while ((c = getopt(argc, argv, "vtepalwxc:s:r:k:f:m:d:H:j:u:o:")) != -1) {
 		switch(c) {
 			case 'v':
 				VERBOSE = true;
@@ -373,15 +1999,159 @@ int main(int argc, char *argv[]){
                 SHOW_PRIO_PREEMPT = true;
 				trace("%s\n", "p: Show the E scheduler's decision  when an unblacked process attempts to preempt the running process");
 				break;
+			case 'a':
+				CPU_AFFINITY = true;
+				trace("a, Pin processes to cpus: %d\n", CPU_AFFINITY);
+				break;
+			case 'l':
+				STREAM_INPUT = true;
+				trace("l, Read processes lazily from the input file: %d\n", STREAM_INPUT);
+				break;
+			case 'w':
+				ASYNC_TRACE = true;
+				trace("w, Write trace output on a background thread: %d\n", ASYNC_TRACE);
+				break;
+			case 'x':
+				EXTENDED_STATISTICS = true;
+				trace("x, Latency percentiles in the statistics: %d\n", EXTENDED_STATISTICS);
+				break;
+			case 'c':
+				NUM_CPUS = atoi(optarg);
+				if (NUM_CPUS < 1) {
+					cout << "Invalid number of cpus <" << optarg << ">" << endl;
+					return 1;
+				}
+				trace("c, Number of cpus: %d\n", NUM_CPUS);
+				break;
+			case 'r':
+				TRACE_RECORD.open(optarg, ios::binary | ios::trunc);
+				if (!TRACE_RECORD) {
+					cerr << "Not a valid trace record file <" << optarg << ">" << endl;
+					return 1;
+				}
+				trace("r, Record binary event trace to: %s\n", optarg);
+				break;
+			case 'k':
+				CHECKPOINT_FILE = optarg;
+				CHECKPOINT_TIME = atoi(optarg);
+				if (CHECKPOINT_FILE.find(':') == string::npos || CHECKPOINT_TIME < 0) {
+					cout << "Invalid checkpoint spec <" << optarg << ">, expected <time>:<file>" << endl;
+					return 1;
+				}
+				CHECKPOINT_FILE = CHECKPOINT_FILE.substr(CHECKPOINT_FILE.find(':') + 1);
+				trace("k, Checkpoint at %d to %s\n", CHECKPOINT_TIME, &CHECKPOINT_FILE[0]);
+				break;
+			case 'u': {
+				// <socket>[:<interval ms>]
+				string spec = optarg;
+				size_t colon = spec.rfind(':');
+				TELEMETRY_SOCKET = spec;
+				if (colon != string::npos && colon + 1 < spec.size()
+					&& spec.find_first_not_of("0123456789", colon + 1) == string::npos) {
+					TELEMETRY_SOCKET = spec.substr(0, colon);
+					TELEMETRY_INTERVAL = atoi(&spec[colon + 1]);
+				}
+				if (TELEMETRY_SOCKET.empty() || TELEMETRY_INTERVAL < 1) {
+					cout << "Invalid telemetry spec <" << optarg << ">, expected <socket>[:<interval ms>]" << endl;
+					return 1;
+				}
+				trace("u, Telemetry on %s every %d ms\n", &TELEMETRY_SOCKET[0], TELEMETRY_INTERVAL);
+				break;
+			}
+			case 'o': {
+				// tt|wait|tp[:<workers>]
+				string spec = optarg;
+				TUNE_OBJECTIVE = spec.substr(0, spec.find(':'));
+				if (spec.find(':') != string::npos) {
+					TUNE_WORKERS = atoi(&spec[spec.find(':') + 1]);
+				}
+				if ((TUNE_OBJECTIVE != "tt" && TUNE_OBJECTIVE != "wait" && TUNE_OBJECTIVE != "tp")
+					|| (spec.find(':') != string::npos && TUNE_WORKERS < 1)) {
+					cout << "Invalid tune spec <" << optarg << ">, expected tt|wait|tp[:<workers>]" << endl;
+					return 1;
+				}
+				trace("o, Autotune for %s, workers %d\n", &TUNE_OBJECTIVE[0], TUNE_WORKERS);
+				break;
+			}
+			case 'f':
+				RESUME_FILE = optarg;
+				trace("f, Resume from checkpoint %s\n", optarg);
+				break;
+			case 'd': {
+				// <devices>[:F|P], FIFO or priority device queues
+				string spec = optarg;
+				int ndevices = atoi(optarg);
+				string discipline = spec.find(':') == string::npos ? "F" : spec.substr(spec.find(':') + 1);
+				if (ndevices < 1 || (discipline != "F" && discipline != "P")) {
+					cout << "Invalid io device spec <" << optarg << ">, expected <devices>[:F|P]" << endl;
+					return 1;
+				}
+				IO_DEVICES.clear();
+				for (int d = 0; d < ndevices; d++) {
+					IO_DEVICES.emplace_back(discipline == "P");
+				}
+				trace("d, IO devices: %d, discipline %s\n", ndevices, &discipline[0]);
+				break;
+			}
+			case 'H':
+				// <hosts>:<latency>[:<threshold>]
+				MIGRATION_THRESHOLD = 2;
+				if (sscanf(optarg, "%d:%d:%d", &HOSTS, &MIGRATION_LATENCY, &MIGRATION_THRESHOLD) < 2
+					|| HOSTS < 1 || MIGRATION_LATENCY < 1 || MIGRATION_THRESHOLD < 1) {
+					cout << "Invalid host spec <" << optarg << ">, expected <hosts>:<latency>[:<threshold>]" << endl;
+					return 1;
+				}
+				trace("H, hosts: %d, migration latency %d, threshold %d\n", HOSTS, MIGRATION_LATENCY, MIGRATION_THRESHOLD);
+				break;
+			case 'j':
+				HOST_WORKERS = atoi(optarg);
+				if (HOST_WORKERS < 1) {
+					cout << "Invalid number of host workers <" << optarg << ">" << endl;
+					return 1;
+				}
+				trace("j, hosts simulating at the same time: %d\n", HOST_WORKERS);
+				break;
+			case 'm': {
+				string spec = optarg;
+				MONTE_CARLO = atoi(optarg);
+				if (spec.find(':') != string::npos) {
+					MONTE_CARLO_SEED = stoul(spec.substr(spec.find(':') + 1));
+				}
+				if (MONTE_CARLO < 1) {
+					cout << "Invalid Monte Carlo spec <" << optarg << ">, expected <replicas>[:<seed>]" << endl;
+					return 1;
+				}
+				trace("m, Monte Carlo replicas: %d, first seed %lu\n", MONTE_CARLO, MONTE_CARLO_SEED);
+				break;
+			}
 			case 's':
 				trace("Optarg: %s\n", optarg);
 				
-				sscanf(optarg, "%1s%d:%d\n", sched_type, &quantum, &maxprio);
-				if ((sched_type[0] == 'R' || sched_type[0] == 'P' || sched_type[0] == 'E') && (quantum < 1)) {
+				sscanf(optarg, "%1s%d:%d:%d\n", sched_type, &quantum, &maxprio, &extra_param);
+				if (sched_type[0] == 'C') {
+					// C[<target latency>[:<maxprio>[:<min granularity>]]]
+					quantum = quantum ? quantum : CFS_DEFAULT_LATENCY;
+					extra_param = extra_param ? extra_param : min(quantum, CFS_DEFAULT_MIN_GRANULARITY);
+					if (quantum < 1 || maxprio < 1 || extra_param < 1 || extra_param > quantum) {
+						cout << "Invalid scheduler param <" << optarg << ">" << endl;
+						return 1;
+					}
+				}
+				if (sched_type[0] == 'M') {
+					// M<quantum>[:<levels>[:<boost period>]], levels also act as maxprio
+					extra_param = extra_param ? extra_param : quantum * MLFQ_DEFAULT_BOOST_QUANTA;
+					if (quantum < 1 || maxprio < 1 || maxprio > MLFQ_MAX_LEVELS || extra_param < 1
+						|| !MLFQQuantumFits(quantum, maxprio)) {
+						cout << "Invalid scheduler param <" << optarg << ">" << endl;
+						return 1;
+					}
+				}
+				if ((sched_type[0] == 'R' || sched_type[0] == 'P' || sched_type[0] == 'E'
+					 || sched_type[0] == 'O' || sched_type[0] == 'D') && (quantum < 1)) {
 					cout << "Invalid scheduler param <" << optarg << ">" << endl;
 					return 1; 
 				}
-				if ((sched_type[0] == 'P' || sched_type[0] == 'E') && (maxprio < 1)) {
+				if ((sched_type[0] == 'P' || sched_type[0] == 'E') && (maxprio < 1 || maxprio > MLQUEUE_MAX_LEVELS)) {
 					cout << "Invalid scheduler param <" << optarg << ">" << endl;
                     return 1;
 				}
@@ -395,6 +2165,30 @@ int main(int argc, char *argv[]){
 		}
 	}
 	
+	RECORD_LATENCY = EXTENDED_STATISTICS || CHECKPOINT_TIME >= 0;
+	if (MONTE_CARLO && (VERBOSE || SHOW_SCHED_READY_QUEUE || SHOW_EVENT_QUEUE || SHOW_PRIO_PREEMPT
+						|| STREAM_INPUT || TRACE_RECORD.is_open() || CHECKPOINT_TIME >= 0 || !RESUME_FILE.empty()
+						|| !TELEMETRY_SOCKET.empty())) {
+		cerr << "-m can not be combined with -v, -t, -e, -p, -l, -r, -k, -f or -u" << endl;
+		return 1;
+	}
+	if (HOSTS && (VERBOSE || SHOW_SCHED_READY_QUEUE || SHOW_EVENT_QUEUE || SHOW_PRIO_PREEMPT || STREAM_INPUT
+				  || TRACE_RECORD.is_open() || CHECKPOINT_TIME >= 0 || !RESUME_FILE.empty() || EXTENDED_STATISTICS || MONTE_CARLO
+				  || !TELEMETRY_SOCKET.empty())) {
+		cerr << "-H can not be combined with -v, -t, -e, -p, -l, -r, -k, -f, -x, -m or -u" << endl;
+		return 1;
+	}
+	if (!TUNE_OBJECTIVE.empty() && (VERBOSE || SHOW_SCHED_READY_QUEUE || SHOW_EVENT_QUEUE || SHOW_PRIO_PREEMPT
+									|| STREAM_INPUT || TRACE_RECORD.is_open() || CHECKPOINT_TIME >= 0 || !RESUME_FILE.empty()
+									|| EXTENDED_STATISTICS || MONTE_CARLO || HOSTS || HOST_WORKERS || !TELEMETRY_SOCKET.empty())) {
+		cerr << "-o can not be combined with -v, -t, -e, -p, -l, -r, -k, -f, -x, -m, -H, -j or -u" << endl;
+		return 1;
+	}
+	if (!TUNE_OBJECTIVE.empty() && sched_type[0] != 'R' && sched_type[0] != 'P' && sched_type[0] != 'E') {
+		cerr << "-o tunes the R, P and E schedulers only" << endl;
+		return 1;
+	}
+
 	// parse non-option arguments	
 	argv += optind;
 	string infile_name;
@@ -413,97 +2207,114 @@ int main(int argc, char *argv[]){
 		return 1;
 	}
 	trace("Input file: %s, Rand File: %s\n", &infile_name[0], &rfile_name[0]);
+	perfStart(input_start);
 
 
-	// Initializing scheduler
-	Scheduler *sched;
-	bool prio_preempt = false;
-	switch (sched_type[0]) {
-		case 'F':
-			trace("%s\n", "Scheduler Type: FCFS"); 
-			sched = new FCFS_scheduler();
-			break;
-		case 'L':
-			trace("%s\n", "Initializing LCFS"); 
-			sched = new LCFS_scheduler();
-			break;
-		case 'S':
-			trace("%s\n", "Initializing SRTF"); 
-			sched = new SRTF_scheduler();
-			break;
-		case 'R':
-			
-			trace("Initializing RR (Round Robin) with quantum %d\n", quantum); 
-			sched = new FCFS_scheduler("RR", quantum);
-			break;
-		case 'P':
-			trace("Initializing PRIO (Priority Scheduler) with quantum %d, maxprio %d\n", quantum, maxprio); 
-			sched = new PRIO_scheduler(quantum, maxprio);
-			break;
-		case 'E':
-			trace("%s\n", "Initializing PREPRIIO (Preemptive Priority Scheduler)"); 
-			prio_preempt = true;
-			sched = new PRIO_scheduler(quantum, maxprio, prio_preempt);
-			break;
-		default:
-			cerr << "Unknown Scheduler spec: -v {FLSRPE}" << endl;
+	// LOTTERY draws from the same random numbers as the bursts
+	RandGenerator rand(rfile_name);
+
+	// Initializing one scheduler (run queue) per cpu
+	vector<Scheduler*> scheds;
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		Scheduler *sched = CreateScheduler(sched_type[0], quantum, maxprio, extra_param, rand);
+		if (sched == nullptr) {
+			cerr << "Unknown Scheduler spec: -v {FLSTRPECMODXY}" << endl;
 			return 1; 
+		}
+		scheds.push_back(sched);
 	}	
+	PROPORTIONAL_SHARE = scheds[0]->sched_type == "LOTTERY" || scheds[0]->sched_type == "STRIDE";
+	REAL_TIME = scheds[0]->sched_type == "EDF" || scheds[0]->sched_type == "RM";
    	
-	// Read the input file and create Process objects
-	vector<Process> processes;
+	// Read the input file into the process table
+	ProcessTable &pt = PROCESS_TABLE;
 	ifstream input(infile_name);
-	RandGenerator rand(rfile_name);
-	int pid = 0;
 	int arrival_time = 0;
 	int total_cpu_time = 0;
 	int cpu_burst = 0;
 	int io_burst = 0;
 	int static_prio = 0;
+	int tickets = 0;
+	int period = 0;
+	int deadline = 0;
 
-	if (input) {
+	if (!RESUME_FILE.empty()) {
+		trace("Processes come from the checkpoint\n");
+	} else if (input && STREAM_INPUT) {
+		trace("Streaming Processes...\n");	
+		PROCESS_STREAM = new ProcessStream(infile_name, maxprio);
+		rand.Skip(PROCESS_STREAM->CountProcesses());
+	} else if (input) {
 		trace("Reading Processes...\n");	
-		while(input >> arrival_time >> total_cpu_time >> cpu_burst >> io_burst) {
+		while(ReadProcessLine(input, arrival_time, total_cpu_time, cpu_burst, io_burst, tickets, period, deadline)) {
 			static_prio = rand.myrandom(maxprio);
-			Process *proc = new Process(pid, arrival_time, total_cpu_time, cpu_burst, io_burst, static_prio);
-			processes.push_back(*proc); 
-			pid++;
-			delete proc;
+			pt.Add(arrival_time, total_cpu_time, cpu_burst, io_burst, static_prio, tickets, period, deadline);
 		}
 	} else {
 		cerr << "Not a valid inputfile <"<< infile_name << ">" << endl;
 		return 1;
 	}
+	perfStop(PERF_PHASE_INPUT, input_start);
 
 	trace("Show Processes:\n");	
-	for (auto i: processes) {
+	for (int pid = 0; pid < pt.Size(); pid++) {
 		trace("process %d, AT: %d, TC: %d, CB: %d, IO: %d\n",
-				i.pid,
-				i.arrival_time,
-				i.total_cpu_time,
-				i.cpu_burst,
-				i.io_burst);
+				pid,
+				pt.arrival_time[pid],
+				pt.total_cpu_time[pid],
+				pt.cpu_burst[pid],
+				pt.io_burst[pid]);
 	}	
 
-	// Initialize DES layer 
-	DES des(processes);
+	if (ASYNC_TRACE) {
+		TRACE_OUT.StartWriter();
+	}
 
-	/*
-	for (auto iter = processes.begin(); iter != processes.end(); iter++) {
-		Event *evt = new Event(&*iter,
-				  iter->arrival_time,
-				  STATE_CREATED,
-				  STATE_READY,
-				  TRANS_TO_READY);			  
-		des.PutEvent(evt);
-	}*/
+	if (TRACE_RECORD.is_open()) {
+		TraceFileHeader hdr = {};
+		copy(begin(TRACE_FILE_MAGIC), end(TRACE_FILE_MAGIC), hdr.magic);
+		hdr.version = TRACE_FILE_VERSION;
+		hdr.num_cpus = NUM_CPUS;
+		hdr.quantum = scheds[0]->quantum;
+		hdr.maxprio = maxprio;
+		scheds[0]->sched_type.copy(hdr.sched_type, sizeof(hdr.sched_type) - 1);
+		TRACE_RECORD.write((const char*)&hdr, sizeof(hdr));
+	}
+
+	RUNNING_PROCESS.assign(NUM_CPUS, NO_PID);
+	CPU_BUSY_TIME.assign(NUM_CPUS, 0);
+	CPU_MIGRATIONS.assign(NUM_CPUS, 0);
+
+	if (MONTE_CARLO) {
+		return MonteCarlo(scheds, rand);
+	}
+	if (!TUNE_OBJECTIVE.empty()) {
+		return Autotune(scheds, sched_type[0], quantum, maxprio, rand);
+	}
+	if (HOSTS) {
+		return MultiHost(scheds, rand);
+	}
+
+	// Initialize DES layer, or restore everything from a checkpoint
+	DES des;
+	if (!RESUME_FILE.empty()) {
+		ReadCheckpoint(des, scheds, rand, infile_name, maxprio);
+	} else {
+		des = DES(pt);
+		if (PROCESS_STREAM) {
+			PutNextArrival(des, rand);
+		}
+	}
 	
-	if (SHOW_EVENT_QUEUE) {
-		cout << "ShowEventQ:";
-		for (auto &e: des.eventQ) {
-          cout << "  " << e->time_stamp << ":" << e->process->pid;
+	if (SHOW_EVENT_QUEUE && RESUME_FILE.empty()) {
+		TRACE_OUT << "ShowEventQ:";
+		if (des.has_arrival) {
+			TRACE_OUT << "  " << des.arrival.time_stamp << ":" << des.arrival.pid;
+		}
+		for (auto &e: des.QueuedEvents()) {
+          TRACE_OUT << "  " << e.time_stamp << ":" << e.pid;
       	}
-		cout << endl; 
+		TRACE_OUT << '\n'; 
 	}
 
 	// testing des functions	
@@ -514,16 +2325,44 @@ int main(int argc, char *argv[]){
 		des.RemoveEvent(8);
 		des.RemoveEvent(2);
 		des.TraceEventQ();
-		Event *evt = des.GetEvent();
-		trace("Get Event %d\n", evt->eid);
-		des.RemoveEvent(evt->eid);
+		Event evt;
+		des.GetEvent(evt);
+		trace("Get Event %u\n", evt.seq);
+		des.RemoveEvent(evt.pid);
 		des.TraceEventQ();
 	}
 	*/
 
-	simulation(des, *sched, rand);
-	statistics(sched, processes);
+	if (!TELEMETRY_SOCKET.empty()) {
+		TELEMETRY = new Telemetry(TELEMETRY_SOCKET, TELEMETRY_INTERVAL, NUM_CPUS);
+		if (!TELEMETRY->Start()) {
+			cerr << "Can not serve telemetry on <" << TELEMETRY_SOCKET << ">" << endl;
+			return 1;
+		}
+	}
+	RunSimulation(des, scheds, rand);
+	des = DES(); // the queue is empty, its memory goes back before the statistics
+	if (TELEMETRY) {
+		TELEMETRY->Stop();
+	}
+	TRACE_OUT.Flush();
+	if (CHECKPOINT_TIME >= 0) {
+		cerr << "No checkpoint written, the simulation ended before time " << CHECKPOINT_TIME << endl;
+	}
+	if (TRACE_RECORD.is_open()) {
+		TRACE_RECORD.close();
+	}
+	perfStart(statistics_start);
+	statistics(scheds[0], pt);
+	for (int cpu = 0; cpu < NUM_CPUS; cpu++) {
+		scheds[cpu]->ShowStatistics(NUM_CPUS > 1 ? "CPU " + to_string(cpu) + " " : "");
+	}
+	perfStop(PERF_PHASE_STATISTICS, statistics_start);
+	perfReport(cerr);
 
-	delete sched;	
+	for (auto sched: scheds) {
+		delete sched;
+	}
+	delete PROCESS_STREAM;
 	return 0;
 }
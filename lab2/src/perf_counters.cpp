@@ -0,0 +1,31 @@
+#include "perf_counters.h"
+#include <iostream>
+using namespace std;
+
+PerfCounters PERF;
+
+static const char *TRANSITION_NAMES[] = {"ready", "run", "preempt", "block"};
+static const char *PHASE_NAMES[] = {"input", "event", "schedule", "checkpoint", "statistics"};
+
+void WritePerfJSON(ostream &out) {
+	long total = 0;
+	out << "{\"events\":{";
+	for (int t = 0; t < 4; t++) {
+		out << (t ? "," : "") << "\"" << TRANSITION_NAMES[t] << "\":" << PERF.events[t];
+		total += PERF.events[t];
+	}
+	out << ",\"total\":" << total << "}"
+		<< ",\"time_steps\":" << PERF.time_steps
+		<< ",\"eventq_high_water\":" << PERF.eventq_high_water
+		<< ",\"put_event\":{\"calls\":" << PERF.put_event_calls
+		<< ",\"compares\":" << PERF.put_event_compares << "}"
+		<< ",\"scheduler_calls\":" << PERF.scheduler_calls
+		<< ",\"context_switches\":" << PERF.context_switches
+		<< ",\"preemptions\":{\"quantum\":" << PERF.quantum_preemptions
+		<< ",\"priority\":" << PERF.priority_preemptions << "}"
+		<< ",\"phase_ns\":{";
+	for (int p = 0; p < PERF_PHASE_COUNT; p++) {
+		out << (p ? "," : "") << "\"" << PHASE_NAMES[p] << "\":" << PERF.phase_ns[p];
+	}
+	out << "}}" << endl;
+}
@@ -0,0 +1,63 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/*
+ * Hot-path counters for the simulation loop, reported as JSON on stderr at
+ * exit. Off by default: build with make PERF=1 (-DPERF_COUNTERS=1).
+ * When off, the perf* macros expand to nothing.
+ */
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif
+
+#include <chrono>
+#include <iosfwd>
+
+typedef enum {
+	PERF_PHASE_INPUT, // reading the processes
+	PERF_PHASE_EVENT, // handling a dispatched event
+	PERF_PHASE_SCHEDULE, // picking processes for idle cpus
+	PERF_PHASE_CHECKPOINT,
+	PERF_PHASE_STATISTICS,
+	PERF_PHASE_COUNT
+} PerfPhase;
+
+struct PerfCounters {
+	long events[4] = {}; // dispatched events, by Transition
+	long time_steps = 0; // distinct time stamps, each ends with one scheduler pass
+	long eventq_high_water = 0;
+	long put_event_calls = 0;
+	long put_event_compares = 0; // event comparisons sifting the queue, on put and remove
+	long scheduler_calls = 0; // GetNextProcess() calls
+	long context_switches = 0; // processes put on a cpu
+	long quantum_preemptions = 0;
+	long priority_preemptions = 0;
+	long phase_ns[PERF_PHASE_COUNT] = {};
+};
+
+extern PerfCounters PERF;
+
+void WritePerfJSON(std::ostream &out);
+
+inline long PerfNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if PERF_COUNTERS
+#define perfCount(field) (PERF.field++)
+#define perfAdd(field, n) (PERF.field += (n))
+#define perfMax(field, n) do { if ((long)(n) > PERF.field) PERF.field = (n); } while(0)
+#define perfStart(start) long start = PerfNow()
+#define perfStop(phase, start) (PERF.phase_ns[phase] += PerfNow() - (start))
+#define perfReport(out) WritePerfJSON(out)
+#else
+#define perfCount(field) do {} while(0)
+#define perfAdd(field, n) do {} while(0)
+#define perfMax(field, n) do {} while(0)
+#define perfStart(start) do {} while(0)
+#define perfStop(phase, start) do {} while(0)
+#define perfReport(out) do {} while(0)
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef RAND_TABLE_H
+#define RAND_TABLE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Binary random table, written by the randtab tool from a text rfile.
+ * A RandTableHeader followed by count int32 values, in host byte order.
+ * The simulator mmaps it read-only instead of parsing the text, so the
+ * Monte Carlo replicas and concurrent runs share one copy in the page cache.
+ * The one definition of the format, lab3's mmu reads it through this header
+ * as well.
+ */
+
+const char RAND_TABLE_MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'R', 'N', 'D'};
+const int32_t RAND_TABLE_VERSION = 1;
+
+struct RandTableHeader {
+	char magic[8];
+	int32_t version;
+	int32_t count;
+};
+
+static_assert(sizeof(RandTableHeader) == 16, "rand table header layout");
+
+// a random table mapped read-only, unmapped on destruction; not copyable,
+// a copy would unmap the table twice
+class RandTableMapping {
+private:
+	void *table = MAP_FAILED;
+	size_t table_size = 0;
+public:
+	int32_t count = 0;
+	const int32_t *values = nullptr;
+	RandTableMapping() = default;
+	RandTableMapping(const RandTableMapping&) = delete;
+	RandTableMapping& operator=(const RandTableMapping&) = delete;
+	~RandTableMapping() {
+		if (table != MAP_FAILED) {
+			munmap(table, table_size);
+		}
+	}
+
+	// false: the file is no random table (a text rfile), exits on a broken one
+	bool Map(const std::string &path) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		RandTableHeader header;
+		struct stat st;
+		if (read(fd, &header, sizeof(header)) != sizeof(header)
+			|| memcmp(header.magic, RAND_TABLE_MAGIC, sizeof(header.magic)) != 0
+			|| fstat(fd, &st) != 0) {
+			close(fd);
+			return false;
+		}
+		if (header.version != RAND_TABLE_VERSION || header.count <= 0
+			|| (size_t)st.st_size < sizeof(header) + (size_t)header.count * sizeof(int32_t)) {
+			std::cerr << "Not a valid random table <" << path << ">" << std::endl;
+			exit(1);
+		}
+		table_size = st.st_size;
+		table = mmap(nullptr, table_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (table == MAP_FAILED) {
+			std::cerr << "Cannot map random table <" << path << ">" << std::endl;
+			exit(1);
+		}
+		count = header.count;
+		values = (const int32_t*)((const char*)table + sizeof(header));
+		return true;
+	}
+};
+
+/*
+ * Modulo by a divisor fixed in advance (Lemire et al., "Faster Remainder by
+ * Direct Computation"): with the reciprocal M = 2^64 / d rounded up,
+ * a % d == ((M * a) mod 2^64) * d / 2^64 for every 32-bit a and d > 0.
+ * Two multiplications instead of a division on the burst generation path.
+ */
+inline uint64_t FastModReciprocal(uint32_t d) {
+	return d > 0 ? UINT64_C(0xFFFFFFFFFFFFFFFF) / d + 1 : 0;
+}
+
+inline uint32_t FastMod(uint32_t a, uint64_t reciprocal, uint32_t d) {
+	uint64_t low_bits = reciprocal * a;
+	return (uint32_t)(((__uint128_t)low_bits * d) >> 64);
+}
+
+#endif
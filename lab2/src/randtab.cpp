@@ -0,0 +1,53 @@
+/*
+ * Converts a text rfile (count, then one number per line) into the binary
+ * random table the simulator can mmap (see rand_table.h).
+ *
+ * usage: randtab <rfile> <tablefile>
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include "rand_table.h"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		cerr << "usage: " << argv[0] << " <rfile> <tablefile>" << endl;
+		return 1;
+	}
+	ifstream rfile(argv[1]);
+	if (!rfile) {
+		cerr << "Not a valid random file <" << argv[1] << ">" << endl;
+		return 1;
+	}
+	long total = 0;
+	rfile >> total;
+	vector<int32_t> randvals;
+	long num;
+	while (rfile >> num) {
+		if (num < 0 || num > INT32_MAX) {
+			cerr << "Random number " << num << " out of range" << endl;
+			return 1;
+		}
+		randvals.push_back(num);
+	}
+	if (total <= 0 || total != (long)randvals.size()) {
+		cerr << "Random file announces " << total << " numbers but has " << randvals.size() << endl;
+		return 1;
+	}
+
+	RandTableHeader header;
+	memcpy(header.magic, RAND_TABLE_MAGIC, sizeof(header.magic));
+	header.version = RAND_TABLE_VERSION;
+	header.count = randvals.size();
+	ofstream out(argv[2], ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)randvals.data(), randvals.size() * sizeof(int32_t));
+	if (!out) {
+		cerr << "Cannot write random table <" << argv[2] << ">" << endl;
+		return 1;
+	}
+	return 0;
+}
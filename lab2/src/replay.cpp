@@ -0,0 +1,307 @@
+/*
+ * Replay a binary event trace recorded with sched -r <file>.
+ * Regenerates the -v lines, the final statistics or a Chrome trace
+ * (chrome://tracing, Perfetto) without re-running the simulation.
+ *
+ * usage: replay [-v] [-s] [-j] <tracefile>
+ *   -v  verbose event lines, as printed by sched -v
+ *   -s  per-process statistics and SUM line (default)
+ *   -j  Chrome trace JSON: run slices per cpu, ready/io slices per process
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iomanip>
+#include <unistd.h>
+
+#include "sched.h"
+#include "trace_sink.h"
+#include "trace_record.h"
+
+using namespace std;
+
+bool VERBOSE = false; // -v
+bool STATISTICS = false; // -s
+bool CHROME_TRACE = false; // -j
+
+TraceFileHeader HEADER;
+
+// per-process state rebuilt from the records
+struct ReplayTable {
+	vector<int> arrival_time;
+	vector<int> total_cpu_time;
+	vector<int> cpu_burst;
+	vector<int> io_burst;
+	vector<int> static_prio;
+	vector<int> finish_time;
+	vector<int> io_time;
+	vector<int> wait_time;
+	vector<int> run_start; // time the current cpu burst started
+	vector<int> cpu; // cpu the process last ran on
+};
+
+ReplayTable RT;
+vector<int> CPU_BUSY_TIME;
+vector<int> CPU_MIGRATIONS;
+int IO_USE = 0;
+int LAST_IO_END_TIME = 0;
+bool FIRST_JSON_EVENT = true;
+
+void AddProcess(const TraceRecord &rec) {
+	int n = rec.pid + 1;
+	if ((int)RT.arrival_time.size() < n) {
+		RT.arrival_time.resize(n);
+		RT.total_cpu_time.resize(n);
+		RT.cpu_burst.resize(n);
+		RT.io_burst.resize(n);
+		RT.static_prio.resize(n);
+		RT.finish_time.resize(n);
+		RT.io_time.resize(n);
+		RT.wait_time.resize(n);
+		RT.run_start.resize(n);
+		RT.cpu.resize(n, -1);
+	}
+	RT.arrival_time[rec.pid] = rec.time_stamp;
+	RT.total_cpu_time[rec.pid] = rec.rem;
+	RT.cpu_burst[rec.pid] = rec.cpu_burst;
+	RT.io_burst[rec.pid] = rec.io_burst;
+	RT.static_prio[rec.pid] = rec.prio;
+}
+
+// same text as TraceEventExecution() in main.cpp
+void PrintEvent(const TraceRecord &rec) {
+	TRACE_OUT << rec.time_stamp << " " << rec.pid << " " << rec.time_in_prev_state << ": ";
+	TRACE_OUT << PROCESS_STATE_TO_STR[rec.old_state] << " -> "
+			  << PROCESS_STATE_TO_STR[rec.new_state] << " ";
+	switch (rec.transition) {
+		case TRANS_TO_READY:
+			TRACE_OUT << '\n';
+			break;
+		case TRANS_TO_PREEMPT:
+			TRACE_OUT << " cb=" << rec.cpu_burst << " rem=" << rec.rem << " prio=" << rec.prio << '\n';
+			break;
+		case TRANS_TO_RUN:
+			TRACE_OUT << " cb=" << rec.cpu_burst << " rem=" << rec.rem << " prio=" << rec.prio;
+			if (HEADER.num_cpus > 1) {
+				TRACE_OUT << " cpu=" << rec.cpu;
+			}
+			TRACE_OUT << '\n';
+			break;
+		case TRANS_TO_BLOCK:
+			if (rec.rem) {
+				TRACE_OUT << " ib=" << rec.io_burst << " rem=" << rec.rem << '\n';
+			} else {
+				TRACE_OUT << "Done" << '\n';
+			}
+	}
+}
+
+// ts and dur are in simulation time units, shown as microseconds
+void ChromeSlice(const char *name, const char *cat, int ts, int dur, int track, int tid) {
+	if (dur <= 0) {
+		return;
+	}
+	TRACE_OUT << (FIRST_JSON_EVENT ? "\n" : ",\n");
+	FIRST_JSON_EVENT = false;
+	TRACE_OUT << "{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\",\"ts\":" << ts
+			  << ",\"dur\":" << dur << ",\"pid\":" << track << ",\"tid\":" << tid << "}";
+}
+
+void ChromeMetadata(const char *what, int track, int tid, const string &name) {
+	TRACE_OUT << (FIRST_JSON_EVENT ? "\n" : ",\n");
+	FIRST_JSON_EVENT = false;
+	TRACE_OUT << "{\"name\":\"" << what << "\",\"ph\":\"M\",\"pid\":" << track << ",\"tid\":" << tid
+			  << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+
+void ReplayEvent(const TraceRecord &rec) {
+	int pid = rec.pid;
+	int now = rec.time_stamp;
+	int cpu;
+	string name;
+	switch (rec.transition) {
+		case TRANS_TO_RUN:
+			cpu = rec.cpu;
+			if (RT.cpu[pid] >= 0 && RT.cpu[pid] != cpu) {
+				CPU_MIGRATIONS[cpu]++;
+			}
+			RT.cpu[pid] = cpu;
+			RT.run_start[pid] = now;
+			RT.wait_time[pid] += rec.time_in_prev_state;
+			if (CHROME_TRACE) {
+				ChromeSlice("ready", "ready", now - rec.time_in_prev_state, rec.time_in_prev_state, 1, pid);
+			}
+			break;
+		case TRANS_TO_PREEMPT:
+		case TRANS_TO_BLOCK:
+			cpu = RT.cpu[pid];
+			CPU_BUSY_TIME[cpu] += now - RT.run_start[pid];
+			if (CHROME_TRACE) {
+				name = "P" + to_string(pid);
+				ChromeSlice(name.c_str(), "run", RT.run_start[pid], now - RT.run_start[pid], 0, cpu);
+			}
+			if (rec.transition == TRANS_TO_PREEMPT) {
+				break;
+			}
+			RT.io_time[pid] += rec.io_burst;
+			if (LAST_IO_END_TIME < now + rec.io_burst) {
+				IO_USE += now + rec.io_burst - max(now, LAST_IO_END_TIME);
+				LAST_IO_END_TIME = now + rec.io_burst;
+			}
+			if (CHROME_TRACE) {
+				ChromeSlice("io", "io", now, rec.io_burst, 1, pid);
+			}
+			if (rec.rem == 0) {
+				RT.finish_time[pid] = now;
+			}
+			break;
+	}
+}
+
+// same report as statistics() in main.cpp
+void PrintStatistics() {
+	int last_FT = 0;
+	double cpu_util = 0, io_util = 0, avg_TT = 0, avg_cpu_wait = 0, throughput = 0;
+	int nproc = RT.arrival_time.size();
+	double count = nproc;
+	string sched_type = HEADER.sched_type;
+
+	cout << sched_type;
+	if (sched_type == "RR" || sched_type == "PRIO" || sched_type == "PREPRIO" || sched_type == "CFS" || sched_type == "MLFQ"
+		|| sched_type == "LOTTERY" || sched_type == "STRIDE") {
+		cout << " " << HEADER.quantum;
+	}
+	cout << endl;
+
+	for (int pid = 0; pid < nproc; pid++) {
+		cout << setw(4) << setfill('0') << pid << ": "
+			 << setw(4) << setfill(' ') << RT.arrival_time[pid] << " "
+			 << setw(4) << RT.total_cpu_time[pid] << " "
+			 << setw(4) << RT.cpu_burst[pid] << " "
+			 << setw(4) << RT.io_burst[pid] << " "
+			 << setw(1) << RT.static_prio[pid] << " | ";
+
+		cout << setw(5) << RT.finish_time[pid] << " "
+			 << setw(5) << RT.finish_time[pid] - RT.arrival_time[pid] << " "
+			 << setw(5) << RT.io_time[pid] << " "
+			 << setw(5) << RT.wait_time[pid] << endl;
+		last_FT = max(last_FT, RT.finish_time[pid]);
+		cpu_util += RT.total_cpu_time[pid];
+		avg_TT += RT.finish_time[pid] - RT.arrival_time[pid];
+		avg_cpu_wait += RT.wait_time[pid];
+	}
+
+	cpu_util = cpu_util / last_FT / HEADER.num_cpus * 100;
+	io_util += (double)IO_USE / last_FT * 100;
+	avg_TT /= count;
+	avg_cpu_wait /= count;
+	throughput = 100 * count / last_FT;
+	cout << "SUM: "
+		 << last_FT << " "
+		 << fixed << setprecision(2) << cpu_util << " "
+		 << fixed << setprecision(2) << io_util << " "
+		 << fixed << setprecision(2) << avg_TT << " "
+		 << fixed << setprecision(2) << avg_cpu_wait << " "
+		 << fixed << setprecision(3) << throughput << endl;
+
+	if (HEADER.num_cpus > 1) {
+		for (int cpu = 0; cpu < HEADER.num_cpus; cpu++) {
+			cout << "CPU " << cpu << ": "
+				 << fixed << setprecision(2) << (double)CPU_BUSY_TIME[cpu] / last_FT * 100 << " "
+				 << CPU_MIGRATIONS[cpu] << endl;
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	char c;
+	opterr = 0;
+	while ((c = getopt(argc, argv, "vsj")) != -1) {
+		switch (c) {
+			case 'v':
+				VERBOSE = true;
+				break;
+			case 's':
+				STATISTICS = true;
+				break;
+			case 'j':
+				CHROME_TRACE = true;
+				break;
+			case '?':
+				cerr << "invalid option -- \'" << char(optopt) << "\'\n";
+				return 1;
+		}
+	}
+	if (CHROME_TRACE && (VERBOSE || STATISTICS)) {
+		cerr << "-j can not be combined with -v or -s" << endl;
+		return 1;
+	}
+	if (!VERBOSE && !CHROME_TRACE) {
+		STATISTICS = true;
+	}
+
+	argv += optind;
+	if (argv[0] == NULL) {
+		cerr << "Not a valid trace file <(null)>" << endl;
+		return 1;
+	}
+	ifstream input(argv[0], ios::binary);
+	if (!input.read((char*)&HEADER, sizeof(HEADER))
+		|| memcmp(HEADER.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0) {
+		cerr << "Not a valid trace file <" << argv[0] << ">" << endl;
+		return 1;
+	}
+	if (HEADER.version != TRACE_FILE_VERSION || HEADER.num_cpus < 1) {
+		cerr << "Unsupported trace file version <" << HEADER.version << ">" << endl;
+		return 1;
+	}
+	HEADER.sched_type[sizeof(HEADER.sched_type) - 1] = '\0';
+	CPU_BUSY_TIME.assign(HEADER.num_cpus, 0);
+	CPU_MIGRATIONS.assign(HEADER.num_cpus, 0);
+
+	if (CHROME_TRACE) {
+		TRACE_OUT << "{\"traceEvents\":[";
+		ChromeMetadata("process_name", 0, 0, string("CPUs (") + HEADER.sched_type + ")");
+		ChromeMetadata("process_name", 1, 0, "Processes");
+		for (int cpu = 0; cpu < HEADER.num_cpus; cpu++) {
+			ChromeMetadata("thread_name", 0, cpu, "CPU " + to_string(cpu));
+		}
+	}
+
+	// read the records in chunks
+	vector<TraceRecord> recs(4096);
+	while (input) {
+		input.read((char*)recs.data(), recs.size() * sizeof(TraceRecord));
+		int n = input.gcount() / sizeof(TraceRecord);
+		for (int i = 0; i < n; i++) {
+			const TraceRecord &rec = recs[i];
+			if (rec.kind == REC_PROCESS) {
+				AddProcess(rec);
+				if (CHROME_TRACE) {
+					ChromeMetadata("thread_name", 1, rec.pid, "P" + to_string(rec.pid));
+				}
+				continue;
+			}
+			if (rec.pid < 0 || rec.pid >= (int)RT.arrival_time.size()
+				|| (rec.transition == TRANS_TO_RUN && (rec.cpu < 0 || rec.cpu >= HEADER.num_cpus))) {
+				cerr << "Corrupt trace record for pid <" << rec.pid << ">" << endl;
+				return 1;
+			}
+			if (VERBOSE) {
+				PrintEvent(rec);
+			}
+			ReplayEvent(rec);
+		}
+	}
+
+	if (CHROME_TRACE) {
+		TRACE_OUT << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+	TRACE_OUT.Flush();
+	if (STATISTICS) {
+		PrintStatistics();
+	}
+	return 0;
+}
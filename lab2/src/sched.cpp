@@ -1,197 +1,328 @@
 #include "sched.h"
+#include "trace_sink.h"
+#include "perf_counters.h"
+#include "rand_table.h"
 #include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <limits>
 using namespace std;
 
+ProcessTable PROCESS_TABLE;
 
-Process::Process(int pid, int at, int tc, int cb, int io, int prio) : 
-	pid(pid), 
-	arrival_time(at),
-	total_cpu_time(tc),
-	cpu_burst(cb),
-	io_burst(io),
-	static_prio(prio),
-	dynamic_prio(prio - 1),
-	state_time_stamp(at),
-	rem_cpu_time(tc) {
-
+int ProcessTable::Add(int at, int tc, int cb, int io, int prio, int tickets, int period, int deadline) {
+	int pid = this->Size();
 	traceSched("Creating proces %d: %d, %d, %d, %d, static_prioity: %d\n",
-				pid,
-				arrival_time,
-				total_cpu_time,
-				cpu_burst,
-				io_burst,
-				static_prio
-				);
-}
-
-Event::Event(Process *proc, int ts, ProcessState os, ProcessState ns, Transition t) :
-	eid(EVENT_COUNTER++),
-	process(proc),
+				pid, at, tc, cb, io, prio);
+
+	arrival_time.push_back(at);
+	total_cpu_time.push_back(tc);
+	cpu_burst.push_back(cb);
+	io_burst.push_back(io);
+	cpu_burst_mod.push_back(FastModReciprocal(cb));
+	io_burst_mod.push_back(FastModReciprocal(io));
+	static_prio.push_back(prio);
+
+	rem_cpu_time.push_back(tc);
+	dynamic_prio.push_back(prio - 1);
+	state_time_stamp.push_back(at);
+
+	rem_cpu_burst.push_back(0);
+	cpu.push_back(-1);
+	pending_evt.push_back(nullptr);
+	time_to_pending_evt.push_back(0);
+	vruntime.push_back(0);
+	charged_cpu_time.push_back(0);
+	mlfq_level.push_back(0);
+	level_cpu_time.push_back(0);
+	boost_epoch.push_back(0);
+	this->tickets.push_back(tickets > 0 ? tickets : prio * TICKETS_PER_PRIO);
+	share_clock_start.push_back(0);
+	migrated.push_back(0);
+	this->period.push_back(period);
+	this->deadline.push_back(deadline > 0 ? deadline : period);
+	abs_deadline.push_back(0);
+
+	wait_time.push_back(0);
+	io_time.push_back(0);
+	finish_time.push_back(0);
+	entitled_cpu_time.push_back(0);
+	return pid;
+}
+
+Event::Event(int pid, int ts, ProcessState os, ProcessState ns, Transition t) :
 	time_stamp(ts),
+	pid(pid),
+	seq(0),
 	old_state(os),
 	new_state(ns),
 	transition(t) {
 
-	traceDES("Created event %d:  time stamp(%d), process(%d), old state(%s), new_state(%s), transition: %s\n",
-		 eid,
+	traceDES("Created event:  time stamp(%d), process(%d), old state(%s), new_state(%s), transition: %s\n",
 		 time_stamp,
-		 process->pid,
+		 pid,
 		 &PROCESS_STATE_TO_STR[old_state][0],
 		 &PROCESS_STATE_TO_STR[new_state][0],
 		 &TRANSITION_TO_STR[transition][0]
 	);				 		
 }	
 
-DES::DES(vector<Process> &processes) {
+DES::DES(ProcessTable &procs) {
 	traceDES("Initializing DES Event Queue...\n");
-	for (auto &proc: processes) {
+	arrivals.reserve(procs.Size());
+	for (int pid = 0; pid < procs.Size(); pid++) {
 	
-		Event *evt = new Event(&proc,
-	                   proc.arrival_time,
+		arrivals.emplace_back(pid,
+	                   procs.arrival_time[pid],
                    	   STATE_CREATED,
                        STATE_READY,
                       TRANS_TO_READY);
-		
-		// sort by time stamp
-		auto iter = eventQ.begin();
-		while (iter != eventQ.end()) {
-			if (evt->time_stamp <= (*iter)->time_stamp) {
-				if (TRACE_DES > 3) {
-					traceDES("Compare event time stamp: %d, curr iter time stamp: %d\n", evt->time_stamp, (*iter)->time_stamp);
-				}
-				break;
-			} 		
-			iter++;
-		}
-		
-		// if process arrives at the same time (same time stamps), order by pid
-		while (iter != eventQ.end() && evt->time_stamp == (*iter)->time_stamp) {
-			if (TRACE_DES > 3) {
-				traceDES("Event process id %d, Current process id %d\n", evt->process->pid, (*iter)->process->pid);
-			}
-			if (evt->process->pid <= (*iter)->process->pid) {
-				break;
-			}
-			iter++;
-		}
-		traceDES("Insert Event %d to EventQ\n", evt->eid);	
-		eventQ.insert(iter, evt);
 	}
+
+	// sort by time stamp, if processes arrive at the same time (same time stamps), order by pid
+	stable_sort(arrivals.begin(), arrivals.end(), [](const Event &a, const Event &b) {
+		return a.time_stamp < b.time_stamp;
+	});
+	heap_pos.assign(procs.Size(), -1);
+	traceDES("Inserted %d arrival events to EventQ\n", (int)arrivals.size());	
 } 
 
+void DES::Place(int pos, const Event &evt) {
+	heap[pos] = evt;
+	heap_pos[evt.pid] = pos;
+}
 
-void DES::PutEvent(Event *evt) {
-	traceDES("Put Event %d\n", evt->eid);
-	auto iter = eventQ.begin();
-	while (iter != eventQ.end()) {
-		if (evt->time_stamp < (*iter)->time_stamp) {
-			if (TRACE_DES > 3) {
-				traceDES("Compare event time stamp: %d, curr iter time stamp: %d\n", 
-							evt->time_stamp, 
-							(*iter)->time_stamp);
-			}
-			break;
-		} 		
-		iter++;
+// every comparison that keeps the heap in order is a put_event compare
+bool DES::HeapBefore(const Event &a, const Event &b) const {
+	perfCount(put_event_compares);
+	return Before(a, b);
+}
+
+void DES::SiftUp(int pos) {
+	Event evt = heap[pos];
+	while (pos > 0 && HeapBefore(evt, heap[(pos - 1) / 2])) {
+		Place(pos, heap[(pos - 1) / 2]);
+		pos = (pos - 1) / 2;
 	}
-	/*	
-	// if process arrives at the same time (same time stamps), order by pid
-	while (iter != eventQ.end() && evt->time_stamp == (*iter)->time_stamp) {
-		if (TRACE_DES > 3) {
-			traceDES("Event process id %d, Current process id %d\n", evt->process->pid, (*iter)->process->pid);
+	Place(pos, evt);
+}
+
+void DES::SiftDown(int pos) {
+	Event evt = heap[pos];
+	int n = heap.size();
+	while (2 * pos + 1 < n) {
+		int child = 2 * pos + 1;
+		if (child + 1 < n && HeapBefore(heap[child + 1], heap[child])) {
+			child++;
 		}
-		if (evt->process->pid <= (*iter)->process->pid) {
+		if (!HeapBefore(heap[child], evt)) {
 			break;
 		}
-		iter++;
+		Place(pos, heap[child]);
+		pos = child;
 	}
-	*/	
-	eventQ.insert(iter, evt);
+	Place(pos, evt);
+}
+
+// the insertion counter wrapped: number the queued events again, in queue order
+void DES::Renumber() {
+	traceDES("Renumbering %d queued events\n", (int)heap.size());
+	sort(heap.begin(), heap.end(), [this](const Event &a, const Event &b) { return Before(a, b); });
+	next_seq = 0;
+	for (int pos = 0; pos < (int)heap.size(); pos++) {
+		heap[pos].seq = next_seq++;
+		heap_pos[heap[pos].pid] = pos;
+	}
+}
+
+void DES::PutArrival(const Event &evt) {
+	traceDES("Put Arrival of process %d\n", evt.pid);
+	arrival = evt;
+	has_arrival = true;
+}
+
+
+void DES::PutEvent(Event evt) {
+	traceDES("Put Event of process %d\n", evt.pid);
+	perfCount(put_event_calls);
+	// the event goes behind all events with the same or an earlier time stamp
+	if (next_seq == UINT32_MAX) {
+		this->Renumber();
+	}
+	evt.seq = next_seq++;
+	if (evt.pid >= (int)heap_pos.size()) {
+		heap_pos.resize(evt.pid + 1, -1);
+	}
+	heap.push_back(evt);
+	this->SiftUp(heap.size() - 1);
+	perfMax(eventq_high_water, heap.size());
 	if (TRACE_DES > 2) {
 		this->TraceEventQ();
 	}
 }
 
+// the input's arrivals were queued before any other event, so they go first
+// among events with the same time stamp, behind a streamed arrival only
+DES::EventSource DES::NextSource() const {
+	EventSource source = heap.empty() ? NO_EVENT : QUEUED_EVENT;
+	int time_stamp = heap.empty() ? 0 : heap[0].time_stamp;
+	if (next_arrival < arrivals.size() && (source == NO_EVENT || arrivals[next_arrival].time_stamp <= time_stamp)) {
+		source = INPUT_ARRIVAL;
+		time_stamp = arrivals[next_arrival].time_stamp;
+	}
+	if (has_arrival && (source == NO_EVENT || arrival.time_stamp <= time_stamp)) {
+		source = STREAMED_ARRIVAL;
+	}
+	return source;
+}
+
 /* Get the first event in the queue
  */
 
 
-Event* DES::GetEvent() {
-	if (eventQ.empty()) {
-		return nullptr;
+bool DES::GetEvent(Event &evt) {
+	switch (this->NextSource()) {
+		case STREAMED_ARRIVAL:
+			evt = arrival;
+			has_arrival = false;
+			return true;
+		case INPUT_ARRIVAL:
+			evt = arrivals[next_arrival++];
+			return true;
+		case QUEUED_EVENT:
+			evt = heap[0];
+			this->RemoveEvent(evt.pid);
+			return true;
+		default:
+			return false;
 	}
-	Event *evt = eventQ.front();
-	eventQ.pop_front();
-	return evt;
 }
 
-void DES::RemoveEvent(int eid) {
-	auto iter = eventQ.begin();
-	bool found = false;
-	while (iter != eventQ.end()) {
-    	if ((*iter)->eid == eid) {
-        	traceDES("Removing event: %d\n", (*iter)->eid);
-        	eventQ.erase(iter);
-			found = true;
-			break;
-        }   
-        iter++;
-	}   
-	if (not found) {
-		traceDES("Event %d does not exist.\n", eid);
+void DES::RemoveEvent(int pid) {
+	int pos = pid < (int)heap_pos.size() ? heap_pos[pid] : -1;
+	if (pos < 0) {
+		traceDES("No event of process %d to remove.\n", pid);
+		return;
+	}
+	traceDES("Removing event of process %d\n", pid);
+	heap_pos[pid] = -1;
+	Event last = heap.back();
+	heap.pop_back();
+	if (pos < (int)heap.size()) {
+		Place(pos, last);
+		if (pos > 0 && HeapBefore(last, heap[(pos - 1) / 2])) {
+			this->SiftUp(pos);
+		} else {
+			this->SiftDown(pos);
+		}
 	}
 }
 
+vector<Event> DES::QueuedEvents() const {
+	vector<Event> queued(heap);
+	sort(queued.begin(), queued.end(), [this](const Event &a, const Event &b) { return Before(a, b); });
+	vector<Event> events;
+	merge(arrivals.begin() + next_arrival, arrivals.end(), queued.begin(), queued.end(), back_inserter(events),
+		  [](const Event &a, const Event &b) { return a.time_stamp < b.time_stamp; });
+	return events;
+}
+
 void DES::ShowEventQ() {
-	for (auto &e: eventQ) {
+	bool shown_arrival = !has_arrival;
+	for (const Event &e: this->QueuedEvents()) {
+		if (!shown_arrival && arrival.time_stamp <= e.time_stamp) {
+			TRACE_OUT << "  " << arrival.time_stamp << ":" << arrival.pid << ":" << TRANSITION_TO_STR[arrival.transition];
+			shown_arrival = true;
+		}
 		// Timestamp:PID:State
-		cout << "  " 
-			 << e->time_stamp << ":" 
-			 << e->process->pid << ":"
-			 << TRANSITION_TO_STR[e->transition];
+		TRACE_OUT << "  " 
+			 << e.time_stamp << ":" 
+			 << e.pid << ":"
+			 << TRANSITION_TO_STR[e.transition];
+	}
+	if (!shown_arrival) {
+		TRACE_OUT << "  " << arrival.time_stamp << ":" << arrival.pid << ":" << TRANSITION_TO_STR[arrival.transition];
 	}
 	 
 }
 
 void DES::TraceEventQ() {
 	traceDES("Trace EventQ ...\n");
-	if (eventQ.empty()) {
+	if (heap.empty() && next_arrival == arrivals.size()) {
 		traceDES("No events left in EventQ.\n");
 	} else  {
-		for (auto &i: eventQ) {
-			traceDES("Event %d: process: %d, time stamp: %d, old state: %d, new state: %d, transition: %d \n", 
-				i->eid, 
-				i->process->pid, 
-				i->time_stamp,
-				i->old_state,
-				i->new_state,
-				i->transition
+		for (const Event &i: this->QueuedEvents()) {
+			traceDES("Event %u: process: %d, time stamp: %d, old state: %d, new state: %d, transition: %d \n", 
+				i.seq, 
+				i.pid, 
+				i.time_stamp,
+				i.old_state,
+				i.new_state,
+				i.transition
 			); 
 		}
 	}
 }
 
 int DES::GetNextEventTime() {
-	if (eventQ.empty()) {
-		return -1;
+	switch (this->NextSource()) {
+		case STREAMED_ARRIVAL:
+			return arrival.time_stamp;
+		case INPUT_ARRIVAL:
+			return arrivals[next_arrival].time_stamp;
+		case QUEUED_EVENT:
+			traceDES("Next Event: %u,Time Stamp: %d\n", heap[0].seq, heap[0].time_stamp);
+			return heap[0].time_stamp;	
+		default:
+			return -1;
 	}
-	traceDES("Next Event: %d,Time Stamp: %d\n", eventQ.front()->eid, eventQ.front()->time_stamp);
-	return eventQ.front()->time_stamp;	
 }
 
 Event* DES::GetPendingEventByPID(int pid) {
-	auto iter = eventQ.begin();
-	while (iter != eventQ.end()) {
-    	if ((*iter)->process->pid == pid) {
-        	traceDES("Found pending event: %d\n", (*iter)->eid);
-			return *iter;
-        }   
-        iter++;
-	} 
+	int pos = pid < (int)heap_pos.size() ? heap_pos[pid] : -1;
+	if (pos >= 0) {
+		traceDES("Found pending event: %u\n", heap[pos].seq);
+		return &heap[pos];
+	}
 	
 	traceDES("No pending event for process %d.\n", pid);
 	return nullptr;
 }
+/*
+ * I/O device
+ */
+
+void IODevice::Enqueue(int pid, int io_burst, int now) {
+	int key = priority ? -PROCESS_TABLE.static_prio[pid] : 0;
+	queue.insert({key, seq++, pid, io_burst, now});
+	max_queue = max(max_queue, (int)queue.size());
+}
+
+IORequest IODevice::Dequeue() {
+	IORequest req = *queue.begin();
+	queue.erase(queue.begin());
+	return req;
+}
+
+void IODevice::Save(ostream &out) {
+	out << current << " " << seq << " " << busy_time << " " << requests << " "
+		<< queue_delay << " " << max_queue << " " << queue.size() << '\n';
+	for (auto &req: queue) {
+		out << req.key << " " << req.seq << " " << req.pid << " " << req.io_burst << " " << req.enqueue_time << '\n';
+	}
+}
+
+void IODevice::Load(istream &in) {
+	long n = 0;
+	IORequest req;
+	queue.clear();
+	in >> current >> seq >> busy_time >> requests >> queue_delay >> max_queue >> n;
+	for (long i = 0; i < n && in >> req.key >> req.seq >> req.pid >> req.io_burst >> req.enqueue_time; i++) {
+		queue.insert(req);
+	}
+}
+
 /*
  * Base Scheduler
  */
@@ -217,33 +348,33 @@ FCFS_scheduler::FCFS_scheduler(string type, int quantum) : Scheduler(type, quant
 	traceSched("Initializing FCFS scheduler\n");
 }
 
-void FCFS_scheduler::AddProcess(Process *p) {
-	readyQ.push_back(p);	
+void FCFS_scheduler::AddProcess(int pid) {
+	readyQ.push_back(pid);	
 	// this->ShowReadyQueue();
 }
 
-Process* FCFS_scheduler::GetNextProcess() {
+int FCFS_scheduler::GetNextProcess() {
 	if (readyQ.empty()) {
-		return nullptr;
+		return NO_PID;
 	}
-	Process *proc = readyQ.front();
+	int pid = readyQ.front();
 	readyQ.pop_front();
-	return proc;
+	return pid;
 }
 
 void FCFS_scheduler::ShowReadyQueue() {
 	if (TRACE_SCHED > 2) {
 		traceSched("Show ReadyQ...\n");
-		for (auto &p: readyQ) {
-			traceSched("Process %d, Entry Time: %d\n", p->pid, p->state_time_stamp); 
+		for (int pid: readyQ) {
+			traceSched("Process %d, Entry Time: %d\n", pid, PROCESS_TABLE.state_time_stamp[pid]); 
 		}
 	}
 	
-	cout << "SCHED (" << readyQ.size() << "):";
-	for (auto &p: readyQ) {
-		cout << "  " << p->pid << ":" << p->state_time_stamp; 
+	TRACE_OUT << "SCHED (" << readyQ.size() << "):";
+	for (int pid: readyQ) {
+		TRACE_OUT << "  " << pid << ":" << PROCESS_TABLE.state_time_stamp[pid]; 
 	}	
-	cout << endl;
+	TRACE_OUT << '\n';
 }
 
 /*
@@ -254,87 +385,179 @@ LCFS_scheduler::LCFS_scheduler() : Scheduler("LCFS") {
 	traceSched("Initializing LCFS scheduler\n");
 }
 
-void LCFS_scheduler::AddProcess(Process *p) {
-	readyQ.push_back(p);	
+void LCFS_scheduler::AddProcess(int pid) {
+	readyQ.push_back(pid);	
 	// this->ShowReadyQueue();
 }
 
-Process* LCFS_scheduler::GetNextProcess() {
+int LCFS_scheduler::GetNextProcess() {
 	if (readyQ.empty()) {
-		return nullptr;
+		return NO_PID;
 	}
-	Process *proc = readyQ.back();
+	int pid = readyQ.back();
 	readyQ.pop_back();
-	return proc;
+	return pid;
 }
 
 void LCFS_scheduler::ShowReadyQueue() {
 	if (TRACE_SCHED > 2) {
 		traceSched("Show ReadyQ...\n");
-		for (auto &p: readyQ) {
-			traceSched("Process %d, Entry Time: %d\n", p->pid, p->state_time_stamp); 
+		for (int pid: readyQ) {
+			traceSched("Process %d, Entry Time: %d\n", pid, PROCESS_TABLE.state_time_stamp[pid]); 
 		}
 	}
 	
-	cout << "SCHED (" << readyQ.size() << "):";
-	for (auto &p: readyQ) {
-		cout << "  " << p->pid << ":" << p->state_time_stamp; 
+	TRACE_OUT << "SCHED (" << readyQ.size() << "):";
+	for (int pid: readyQ) {
+		TRACE_OUT << "  " << pid << ":" << PROCESS_TABLE.state_time_stamp[pid]; 
 	}	
-	cout << endl;
+	TRACE_OUT << '\n';
 }
 
 /*
- * SRTF Scheduler
+ * SRTF Scheduler / PSRTF (Preemptive SRTF) Scheduler
  */
 
-SRTF_scheduler::SRTF_scheduler() : Scheduler("SRTF") {
+SRTF_scheduler::SRTF_scheduler() : Scheduler("SRTF"), srtf_preempt(false) {
 	traceSched("Initializing %s scheduler\n", &sched_type[0]);
 }
 
-void SRTF_scheduler::AddProcess(Process *p) {
-	traceSched("Add Process %d, Remaining Execution Time %d\n", p->pid, p->rem_cpu_time);
-	// sort by the remaining cpu time
-	
-	auto iter = readyQ.begin();
-	while (iter != readyQ.end()) {
-		if (p->rem_cpu_time < (*iter)->rem_cpu_time) {
-			break;
-		}
-		iter++; 
-	}
-	
-	readyQ.insert(iter, p);	
-	// this->ShowReadyQueue();
+SRTF_scheduler::SRTF_scheduler(bool srtf_preempt) : 
+	Scheduler(srtf_preempt ? "PSRTF" : "SRTF"), 
+	srtf_preempt(srtf_preempt) {
+	traceSched("Initializing %s scheduler\n", &sched_type[0]);
+}
+
+void SRTF_scheduler::AddProcess(int pid) {
+	traceSched("Add Process %d, Remaining Execution Time %d\n", pid, PROCESS_TABLE.rem_cpu_time[pid]);
+	// sort by the remaining cpu time, a later insert goes behind equal ones
+	readyQ.push_back({PROCESS_TABLE.rem_cpu_time[pid], seq++, pid});
+	push_heap(readyQ.begin(), readyQ.end(), greater<HeapEntry>());
 }
 
-Process* SRTF_scheduler::GetNextProcess() {
+int SRTF_scheduler::GetNextProcess() {
 	if (readyQ.empty()) {
-		return nullptr;
+		return NO_PID;
 	}
 	
-	Process *proc = readyQ.front();
-	readyQ.pop_front();
-	return proc;
+	pop_heap(readyQ.begin(), readyQ.end(), greater<HeapEntry>());
+	int pid = readyQ.back().pid;
+	readyQ.pop_back();
+	return pid;
 }
 
 void SRTF_scheduler::ShowReadyQueue() {
+	// the heap is only partially ordered, show the queue in dispatch order
+	vector<HeapEntry> sorted(readyQ);
+	sort(sorted.begin(), sorted.end(), [](const HeapEntry &a, const HeapEntry &b) { return b > a; });
+
 	if (TRACE_SCHED > 2) {
 		traceSched("Show ReadyQ...\n");
-		for (auto &p: readyQ) {
+		for (auto &e: sorted) {
 			traceSched("Process %d, Entry Time: %d, Remain CPU Time: %d\n", 
-				p->pid, 
-				p->state_time_stamp,
-				p->rem_cpu_time); 
+				e.pid, 
+				PROCESS_TABLE.state_time_stamp[e.pid],
+				PROCESS_TABLE.rem_cpu_time[e.pid]); 
 		}
 	}
 	
-	cout << "SCHED (" << readyQ.size() << "):";
-	for (auto &p: readyQ) {
-		cout << "  " << p->pid << ":" << p->state_time_stamp; 
+	TRACE_OUT << "SCHED (" << sorted.size() << "):";
+	for (auto &e: sorted) {
+		TRACE_OUT << "  " << e.pid << ":" << PROCESS_TABLE.state_time_stamp[e.pid]; 
 	}	
-	cout << endl;
+	TRACE_OUT << '\n';
 }
 
+vector<int> SRTF_scheduler::ReadyList() {
+	// insertion order, re-adding keeps ties in the same order
+	vector<HeapEntry> sorted(readyQ);
+	sort(sorted.begin(), sorted.end(), [](const HeapEntry &a, const HeapEntry &b) { return a.seq < b.seq; });
+	vector<int> pids;
+	for (auto &e: sorted) {
+		pids.push_back(e.pid);
+	}
+	return pids;
+}
+
+bool SRTF_scheduler::TestPreempt(int pid, int current_time, int running_pid) {
+	traceSched("TestPreempt\n");
+	if (!srtf_preempt) {
+		return false;
+	}
+
+	ProcessTable &pt = PROCESS_TABLE;
+	if (running_pid == NO_PID || !pt.pending_evt[running_pid]) {
+		traceSched("No current running process or pending event\n");
+		return false;
+	}
+
+	// rem_cpu_time of the running process was already charged for the whole burst
+	Event *pending_evt = pt.pending_evt[running_pid];
+	pt.time_to_pending_evt[running_pid] = pending_evt->time_stamp - current_time;
+	bool cond1 = pt.rem_cpu_time[pid] < pt.rem_cpu_time[running_pid] + pt.time_to_pending_evt[running_pid];
+	bool cond2 = pending_evt->time_stamp > current_time; 
+	if (SHOW_PRIO_PREEMPT) {
+		TRACE_OUT << "    --> Preempt Cond1=" << cond1 << " Cond2=" << cond2 << " (" << pt.time_to_pending_evt[running_pid]  << ") --> ";
+		if (cond1 && cond2) {
+			TRACE_OUT << "YES" << '\n';
+		} else {
+			TRACE_OUT << "NO" << '\n';
+		}
+	}
+	return cond1 && cond2;
+}
+
+
+/*
+ * Multi-level Queue
+ */
+
+MLQueue::MLQueue(int nlevels) : levels(nlevels), bitmap((nlevels + 63) / 64, 0) {
+	traceSched("Initializing multi-level queue with %d levels\n", nlevels);
+}
+
+void MLQueue::Push(int level, int pid) {
+	levels[level].push_back(pid);
+	bitmap[level / 64] |= (uint64_t)1 << (level % 64);
+	summary |= (uint64_t)1 << (level / 64);
+	count++;
+}
+
+int MLQueue::HighestLevel() {
+	if (count == 0) {
+		return -1;
+	}
+	int word = 63 - __builtin_clzll(summary);
+	return word * 64 + 63 - __builtin_clzll(bitmap[word]);
+}
+
+int MLQueue::PopHighest() {
+	int level = this->HighestLevel();
+	if (level < 0) {
+		return NO_PID;
+	}
+	int pid = levels[level].front();
+	levels[level].pop_front();
+	if (levels[level].empty()) {
+		bitmap[level / 64] &= ~((uint64_t)1 << (level % 64));
+		if (bitmap[level / 64] == 0) {
+			summary &= ~((uint64_t)1 << (level / 64));
+		}
+	}
+	count--;
+	return pid;
+}
+
+deque<int> MLQueue::TakeLevel(int level) {
+	deque<int> taken;
+	swap(taken, levels[level]);
+	bitmap[level / 64] &= ~((uint64_t)1 << (level % 64));
+	if (bitmap[level / 64] == 0) {
+		summary &= ~((uint64_t)1 << (level / 64));
+	}
+	count -= taken.size();
+	return taken;
+}
 
 /*
  * PRIO Scheduler
@@ -342,109 +565,145 @@ void SRTF_scheduler::ShowReadyQueue() {
 
 PRIO_scheduler::PRIO_scheduler(int quantum, int maxprio) : 
 	Scheduler("PRIO", quantum), 
+	activeQ(maxprio),
+	expiredQ(maxprio),
 	maxprio(maxprio),
 	priority_preempt(false) {
 	traceSched("Initializing %s scheduler with maxprio %d, prio preempt %d\n", &sched_type[0], maxprio, priority_preempt);
-	activeQ.resize(maxprio);
-	expiredQ.resize(maxprio);
-	traceSched("ActiveQ Size: %d, ExpiredQ Size: %d\n", activeQ.size(), expiredQ.size());	
+	traceSched("ActiveQ Size: %d, ExpiredQ Size: %d\n", activeQ.Levels(), expiredQ.Levels());	
 }
 
 PRIO_scheduler::PRIO_scheduler(int quantum, int maxprio, bool priority_preempt) : 
 	Scheduler("PREPRIO", quantum), 
+	activeQ(maxprio),
+	expiredQ(maxprio),
 	maxprio(maxprio),
 	priority_preempt(priority_preempt) {
 	traceSched("Initializing %s scheduler with maxprio %d, prio preempt %d\n", &sched_type[0], maxprio, priority_preempt);
-	activeQ.resize(maxprio);
-	expiredQ.resize(maxprio);
-	traceSched("ActiveQ Size: %d, ExpiredQ Size: %d\n", activeQ.size(), expiredQ.size());	
+	traceSched("ActiveQ Size: %d, ExpiredQ Size: %d\n", activeQ.Levels(), expiredQ.Levels());	
 }
 
 
-void PRIO_scheduler::TraceQueue(vector<deque<Process*>> &ml_queue) {
-	int priority = 4;
-	for (auto q = ml_queue.rbegin(); q != ml_queue.rend(); q++) {
-		auto p = q->begin();
-		while (p != q->end()) {
-			traceSched("Prority %d: pid %d\n", priority, (*p)->pid);
-			p++;	
+void PRIO_scheduler::TraceQueue(MLQueue &ml_queue) {
+	for (int priority = ml_queue.Levels() - 1; priority >= 0; priority--) {
+		for (int pid: ml_queue.Level(priority)) {
+			traceSched("Prority %d: pid %d\n", priority, pid);
 		}
-		priority--;
 	}
 
 }
 
 
-void PRIO_scheduler::AddProcess(Process *p) {
-	traceSched("Add Process %d, Remaining Execution Time %d, Dynamic Prio %d\n", p->pid, p->rem_cpu_time, p->dynamic_prio);
+void PRIO_scheduler::AddProcess(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	traceSched("Add Process %d, Remaining Execution Time %d, Dynamic Prio %d\n", pid, pt.rem_cpu_time[pid], pt.dynamic_prio[pid]);
 
-	if (p->dynamic_prio < 0) {
+	if (pt.dynamic_prio[pid] < 0) {
 		// reset and enter p into expireQ
-		p->dynamic_prio = p->static_prio - 1;
-	    expiredQ[p->dynamic_prio].push_back(p);
-		traceSched("Reset dynamic prio to: %d, Add p to expiredQ\n", p->dynamic_prio);
+		pt.dynamic_prio[pid] = pt.static_prio[pid] - 1;
+	    expiredQ.Push(pt.dynamic_prio[pid], pid);
+		traceSched("Reset dynamic prio to: %d, Add p to expiredQ\n", pt.dynamic_prio[pid]);
 	} else {
 		traceSched("Add p to activeQ\n");
-		activeQ[p->dynamic_prio].push_back(p);
+		activeQ.Push(pt.dynamic_prio[pid], pid);
+	}
+	if (TRACE_SCHED > 2) {
+		TraceQueue(activeQ);
+		TraceQueue(expiredQ);
 	}
-	TraceQueue(activeQ);
-	TraceQueue(expiredQ);
 	
 }
 
-bool PRIO_scheduler::IsEmptyQueue_(vector<deque<Process*>> &Q) {
-	int count = 0;
-	for (auto q: Q){
-		count += q.size();
+int PRIO_scheduler::ReadyCount() {
+	return activeQ.Size() + expiredQ.Size();
+}
+
+vector<int> PRIO_scheduler::ReadyList() {
+	vector<int> pids;
+	for (MLQueue *q: {&activeQ, &expiredQ}) {
+		for (int level = q->Levels() - 1; level >= 0; level--) {
+			pids.insert(pids.end(), q->Level(level).begin(), q->Level(level).end());
+		}
 	}
-	
-	traceSched("Process Count: %d\n", count);
-	if (count == 0) {
-		return true;
+	return pids;
+}
+
+// non-empty levels: <count> then <level> <size> <pid>... per level
+void PRIO_scheduler::SaveQueue(ostream &out, MLQueue &ml_queue) {
+	int nonempty = 0;
+	for (int level = 0; level < ml_queue.Levels(); level++) {
+		nonempty += !ml_queue.Level(level).empty();
+	}
+	out << nonempty << '\n';
+	for (int level = 0; level < ml_queue.Levels(); level++) {
+		deque<int> &q = ml_queue.Level(level);
+		if (q.empty()) {
+			continue;
+		}
+		out << level << " " << q.size();
+		for (int pid: q) {
+			out << " " << pid;
+		}
+		out << '\n';
+	}
+}
+
+void PRIO_scheduler::LoadQueue(istream &in, MLQueue &ml_queue) {
+	ml_queue = MLQueue(maxprio);
+	int nonempty = 0, level, size, pid;
+	in >> nonempty;
+	for (int i = 0; i < nonempty && in >> level >> size; i++) {
+		for (int j = 0; j < size && in >> pid; j++) {
+			ml_queue.Push(level, pid);
+		}
 	}
-	return false;
 }
 
+void PRIO_scheduler::SaveState(ostream &out) {
+	SaveQueue(out, activeQ);
+	SaveQueue(out, expiredQ);
+}
+
+void PRIO_scheduler::LoadState(istream &in) {
+	LoadQueue(in, activeQ);
+	LoadQueue(in, expiredQ);
+}
 
-Process* PRIO_scheduler::GetNextProcess() {
+int PRIO_scheduler::GetNextProcess() {
 	bool switched = false;
 	for (int i = 0; i < 2; i++) {
-		if (!this->IsEmptyQueue_(activeQ)) {
-			for (auto q = activeQ.rbegin(); q != activeQ.rend(); q++) {
-				if (!q->empty()) {
-					Process *proc = q->front();
-					q->pop_front();
-					return proc;				
-				}
-			}
+		traceSched("Process Count: %d\n", activeQ.Size());
+		if (!activeQ.Empty()) {
+			return activeQ.PopHighest();
 		} else if (!switched) {
-			activeQ.swap(expiredQ);
+			swap(activeQ, expiredQ);
 			if (SHOW_SCHED_READY_QUEUE) {
-				cout << "switched queues" << endl;
+				TRACE_OUT << "switched queues" << '\n';
 			}
 			switched = true;
 		}
 	}
-	return nullptr;
+	return NO_PID;
 }
 
-void PRIO_scheduler::PrintMLQueue(vector<deque<Process*>> &ml_queue) {
-	cout << "{ ";
-	for (auto q = ml_queue.rbegin(); q != ml_queue.rend(); q++) {
-		cout << "[";
+void PRIO_scheduler::PrintMLQueue(MLQueue &ml_queue) {
+	TRACE_OUT << "{ ";
+	for (int level = ml_queue.Levels() - 1; level >= 0; level--) {
+		deque<int> *q = &ml_queue.Level(level);
+		TRACE_OUT << "[";
 		
 		auto p = q->begin();
 		if (p != q->end()) {
-			cout << (*p)->pid;
+			TRACE_OUT << *p;
 			p++;
 		}
 		while (p != q->end()) {
-			cout << "," << (*p)->pid;
+			TRACE_OUT << "," << *p;
 			p++;	
 		}
-		cout << "]";
+		TRACE_OUT << "]";
 	}
-	cout << "} : ";
+	TRACE_OUT << "} : ";
 
 }
 
@@ -452,42 +711,611 @@ void PRIO_scheduler::ShowReadyQueue() {
 
 	PrintMLQueue(activeQ);
 	PrintMLQueue(expiredQ);
-	cout << endl;	
+	TRACE_OUT << '\n';	
 }
 
-bool PRIO_scheduler::TestPreempt(Process *proc, int current_time, Process *curr_running_proc) {
+bool PRIO_scheduler::TestPreempt(int pid, int current_time, int running_pid) {
 	traceSched("TestPreempt\n");
 	if (!priority_preempt) {
 		return false;
 	}
 
-	if (!curr_running_proc) {//|| !proc->pending_evt) {
+	if (running_pid == NO_PID) {
 		traceSched("No current running process\n");
 		return false;
 	}
 	
-	if (curr_running_proc->pending_evt) {
+	ProcessTable &pt = PROCESS_TABLE;
+	Event *pending_evt = pt.pending_evt[running_pid];
+	if (pending_evt) {
 		traceSched("Pending Event: %d %d %s\n",
-			curr_running_proc->pending_evt->time_stamp,
-			curr_running_proc->pid,
-			&TRANSITION_TO_STR[curr_running_proc->pending_evt->transition][0]);
+			pending_evt->time_stamp,
+			running_pid,
+			&TRANSITION_TO_STR[pending_evt->transition][0]);
 	} else {
-		traceSched("No pending event for process %d\n", proc->pid);
+		traceSched("No pending event for process %d\n", pid);
 		return false;
 	}
 	
-	bool cond1 = proc->dynamic_prio > curr_running_proc->dynamic_prio;
-	bool cond2 = curr_running_proc->pending_evt->time_stamp > current_time; 
-	curr_running_proc->time_to_pending_evt = curr_running_proc->pending_evt->time_stamp - current_time;
+	bool cond1 = pt.dynamic_prio[pid] > pt.dynamic_prio[running_pid];
+	bool cond2 = pending_evt->time_stamp > current_time; 
+	pt.time_to_pending_evt[running_pid] = pending_evt->time_stamp - current_time;
+	if (SHOW_PRIO_PREEMPT) {
+		TRACE_OUT << "    --> Preempt Cond1=" << cond1 << " Cond2=" << cond2 << " (" << pt.time_to_pending_evt[running_pid]  << ") --> ";
+		if (cond1 && cond2) {
+			TRACE_OUT << "YES" << '\n';
+		} else {
+			TRACE_OUT << "NO" << '\n';
+		}
+	}
+	return cond1 && cond2;
+}
+
+
+/*
+ * CFS Scheduler
+ */
+
+// kernel sched_prio_to_weight[], nice -20 .. 19
+static const int CFS_PRIO_TO_WEIGHT[40] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	 9548,  7620,  6100,  4904,  3906,
+	 3121,  2501,  1991,  1586,  1277,
+	 1024,   820,   655,   526,   423,
+	  335,   272,   215,   172,   137,
+	  110,    87,    70,    56,    45,
+	   36,    29,    23,    18,    15
+};
+
+CFS_scheduler::CFS_scheduler(int target_latency, int min_granularity) :
+	Scheduler("CFS", target_latency),
+	target_latency(target_latency),
+	min_granularity(min_granularity) {
+	traceSched("Initializing CFS scheduler with target latency %d, min granularity %d\n", target_latency, min_granularity);
+}
+
+int CFS_scheduler::Weight(int pid) {
+	int nice = max(-20, 1 - PROCESS_TABLE.static_prio[pid]);
+	return CFS_PRIO_TO_WEIGHT[nice + 20];
+}
+
+void CFS_scheduler::AddProcess(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	int weight = this->Weight(pid);
+
+	// charge the cpu time used since the process was last queued
+	int used = pt.total_cpu_time[pid] - pt.rem_cpu_time[pid] - pt.charged_cpu_time[pid];
+	pt.vruntime[pid] += ((long)used << CFS_VRUNTIME_SHIFT) * CFS_NICE_0_WEIGHT / weight;
+	pt.charged_cpu_time[pid] += used;
+
+	if (pt.rem_cpu_burst[pid] == 0) {
+		// new or woken up: sleeping earns at most half a latency of credit
+		long placement = min_vruntime - ((long)target_latency << CFS_VRUNTIME_SHIFT) / 2;
+		pt.vruntime[pid] = max(pt.vruntime[pid], placement);
+	}
+	traceSched("Add Process %d, used %d, weight %d, vruntime %ld\n", pid, used, weight, pt.vruntime[pid]);
+
+	readyQ.insert({pt.vruntime[pid], seq++, pid});
+	ready_weight += weight;
+}
+
+int CFS_scheduler::GetNextProcess() {
+	if (readyQ.empty()) {
+		return NO_PID;
+	}
+	auto first = readyQ.begin();
+	int pid = first->pid;
+	min_vruntime = max(min_vruntime, first->vruntime);
+	readyQ.erase(first);
+	ready_weight -= this->Weight(pid);
+	return pid;
+}
+
+int CFS_scheduler::Quantum(int pid) {
+	// the latency is stretched when min_granularity slices no longer fit in it
+	long nr_running = readyQ.size() + 1;
+	long period = max((long)target_latency, nr_running * min_granularity);
+	int weight = this->Weight(pid);
+	int slice = period * weight / (ready_weight + weight);
+	return max(slice, min_granularity);
+}
+
+vector<int> CFS_scheduler::ReadyList() {
+	vector<int> pids;
+	for (auto &e: readyQ) {
+		pids.push_back(e.pid);
+	}
+	return pids;
+}
+
+void CFS_scheduler::SaveState(ostream &out) {
+	out << min_vruntime << " " << seq << " " << readyQ.size() << '\n';
+	for (auto &e: readyQ) {
+		out << e.vruntime << " " << e.seq << " " << e.pid << '\n';
+	}
+}
+
+void CFS_scheduler::LoadState(istream &in) {
+	long n = 0;
+	TreeEntry e;
+	readyQ.clear();
+	ready_weight = 0;
+	in >> min_vruntime >> seq >> n;
+	for (long i = 0; i < n && in >> e.vruntime >> e.seq >> e.pid; i++) {
+		readyQ.insert(e);
+		ready_weight += this->Weight(e.pid);
+	}
+}
+
+void CFS_scheduler::ShowReadyQueue() {
+	if (TRACE_SCHED > 2) {
+		traceSched("Show ReadyQ...\n");
+		for (auto &e: readyQ) {
+			traceSched("Process %d, Entry Time: %d, vruntime: %ld\n", e.pid, PROCESS_TABLE.state_time_stamp[e.pid], e.vruntime);
+		}
+	}
+
+	TRACE_OUT << "SCHED (" << readyQ.size() << "):";
+	for (auto &e: readyQ) {
+		TRACE_OUT << "  " << e.pid << ":" << PROCESS_TABLE.state_time_stamp[e.pid];
+	}
+	TRACE_OUT << '\n';
+}
+
+
+/*
+ * MLFQ Scheduler
+ */
+
+MLFQ_scheduler::MLFQ_scheduler(int quantum, int levels, int boost_period) :
+	Scheduler("MLFQ", quantum),
+	readyQ(levels),
+	dispatches(levels, 0),
+	demotions(levels, 0),
+	levels(levels),
+	boost_period(boost_period) {
+	traceSched("Initializing MLFQ scheduler with quantum %d, %d levels, boost period %d\n", quantum, levels, boost_period);
+}
+
+// every process goes back to the top level, queued ones in their current order:
+// the level queues move whole, top first, and GetNextProcess() resets the level
+void MLFQ_scheduler::Boost(int epoch) {
+	traceSched("Priority boost %d\n", epoch);
+	for (int level = levels - 1; level >= 0; level--) {
+		if (!readyQ.Level(level).empty()) {
+			boosted_count += readyQ.Level(level).size();
+			boosted.push_back(readyQ.TakeLevel(level));
+		}
+	}
+	boost_period_count = epoch;
+	boosts++;
+}
+
+void MLFQ_scheduler::AddProcess(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+
+	// charge the cpu time used since the process was last queued
+	int used = pt.total_cpu_time[pid] - pt.rem_cpu_time[pid] - pt.charged_cpu_time[pid];
+	pt.charged_cpu_time[pid] += used;
+	pt.level_cpu_time[pid] += used;
+	if (pt.level_cpu_time[pid] >= LevelQuantum(pt.mlfq_level[pid])) {
+		// the bottom level keeps its processes, which is no demotion
+		if (pt.mlfq_level[pid] < levels - 1) {
+			demotions[levels - 1 - pt.mlfq_level[pid]]++;
+			pt.mlfq_level[pid]++;
+		}
+		pt.level_cpu_time[pid] = 0;
+	}
+
+	// the process just changed state, so its time stamp is the current time
+	int epoch = pt.state_time_stamp[pid] / boost_period;
+	if (epoch > boost_period_count) {
+		this->Boost(epoch);
+	}
+	if (pt.boost_epoch[pid] < epoch) {
+		pt.mlfq_level[pid] = 0;
+		pt.level_cpu_time[pid] = 0;
+		pt.boost_epoch[pid] = epoch;
+	}
+	traceSched("Add Process %d, used %d, level %d, level cpu time %d\n", pid, used, pt.mlfq_level[pid], pt.level_cpu_time[pid]);
+	readyQ.Push(levels - 1 - pt.mlfq_level[pid], pid);
+}
+
+int MLFQ_scheduler::GetNextProcess() {
+	ProcessTable &pt = PROCESS_TABLE;
+	int pid;
+	if (!boosted.empty()) {
+		pid = boosted.front().front();
+		boosted.front().pop_front();
+		if (boosted.front().empty()) {
+			boosted.pop_front();
+		}
+		boosted_count--;
+		dispatches[levels - 1]++;
+	} else {
+		int level = readyQ.HighestLevel();
+		if (level < 0) {
+			return NO_PID;
+		}
+		dispatches[level]++;
+		pid = readyQ.PopHighest();
+	}
+	// boosted while queued
+	if (pt.boost_epoch[pid] < boost_period_count) {
+		pt.mlfq_level[pid] = 0;
+		pt.level_cpu_time[pid] = 0;
+		pt.boost_epoch[pid] = boost_period_count;
+	}
+	return pid;
+}
+
+// what is left of the quantum of the process's level
+int MLFQ_scheduler::Quantum(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+	return LevelQuantum(pt.mlfq_level[pid]) - pt.level_cpu_time[pid];
+}
+
+bool MLFQ_scheduler::TestPreempt(int pid, int current_time, int running_pid) {
+	traceSched("TestPreempt\n");
+	ProcessTable &pt = PROCESS_TABLE;
+	if (running_pid == NO_PID || !pt.pending_evt[running_pid]) {
+		traceSched("No current running process or pending event\n");
+		return false;
+	}
+
+	Event *pending_evt = pt.pending_evt[running_pid];
+	bool cond1 = pt.mlfq_level[pid] < pt.mlfq_level[running_pid];
+	bool cond2 = pending_evt->time_stamp > current_time;
+	pt.time_to_pending_evt[running_pid] = pending_evt->time_stamp - current_time;
 	if (SHOW_PRIO_PREEMPT) {
-		cout << "    --> Preempt Cond1=" << cond1 << " Cond2=" << cond2 << " (" << curr_running_proc->time_to_pending_evt  << ") --> ";
+		TRACE_OUT << "    --> Preempt Cond1=" << cond1 << " Cond2=" << cond2 << " (" << pt.time_to_pending_evt[running_pid]  << ") --> ";
 		if (cond1 && cond2) {
-			cout << "YES" << endl;
+			TRACE_OUT << "YES" << '\n';
 		} else {
-			cout << "NO" << endl;
+			TRACE_OUT << "NO" << '\n';
 		}
 	}
 	return cond1 && cond2;
 }
 
+// the queue of a level, the top level behind the processes queued at boosts
+vector<int> MLFQ_scheduler::LevelList(int level) {
+	vector<int> pids;
+	if (level == levels - 1) {
+		for (deque<int> &q: boosted) {
+			pids.insert(pids.end(), q.begin(), q.end());
+		}
+	}
+	pids.insert(pids.end(), readyQ.Level(level).begin(), readyQ.Level(level).end());
+	return pids;
+}
 
+vector<int> MLFQ_scheduler::ReadyList() {
+	vector<int> pids;
+	for (int level = levels - 1; level >= 0; level--) {
+		vector<int> q = LevelList(level);
+		pids.insert(pids.end(), q.begin(), q.end());
+	}
+	return pids;
+}
+
+void MLFQ_scheduler::SaveState(ostream &out) {
+	out << boost_period_count << " " << boosts << '\n';
+	for (int level = 0; level < levels; level++) {
+		vector<int> q = LevelList(level);
+		out << dispatches[level] << " " << demotions[level] << " " << q.size();
+		for (int pid: q) {
+			out << " " << pid;
+		}
+		out << '\n';
+	}
+}
+
+void MLFQ_scheduler::LoadState(istream &in) {
+	int size, pid;
+	readyQ = MLQueue(levels);
+	boosted.clear();
+	boosted_count = 0;
+	in >> boost_period_count >> boosts;
+	for (int level = 0; level < levels; level++) {
+		in >> dispatches[level] >> demotions[level] >> size;
+		for (int i = 0; i < size && in >> pid; i++) {
+			readyQ.Push(level, pid);
+		}
+	}
+}
+
+void MLFQ_scheduler::ShowReadyQueue() {
+	TRACE_OUT << "{ ";
+	for (int level = levels - 1; level >= 0; level--) {
+		TRACE_OUT << "[";
+		bool first = true;
+		for (int pid: LevelList(level)) {
+			TRACE_OUT << (first ? "" : ",") << pid;
+			first = false;
+		}
+		TRACE_OUT << "]";
+	}
+	TRACE_OUT << " }" << '\n';
+}
+
+void MLFQ_scheduler::ShowStatistics(const string &prefix) {
+	// LEVEL <n>: quantum | dispatches | demotions, top level first
+	for (int level = levels - 1; level >= 0; level--) {
+		cout << prefix << "LEVEL " << levels - 1 - level << ": "
+			 << LevelQuantum(levels - 1 - level) << " "
+			 << dispatches[level] << " "
+			 << demotions[level] << endl;
+	}
+	cout << prefix << "BOOSTS: " << boosts << endl;
+}
+
+
+/*
+ * Ticket Queue
+ */
+
+// moves the queued processes to the front slots, and doubles the slots while
+// more than half of them would be taken
+void TicketQueue::Compact() {
+	vector<int> pids;
+	vector<long> tickets;
+	for (size_t slot = 0; slot < slots.size(); slot++) {
+		if (slots[slot] != NO_PID) {
+			pids.push_back(slots[slot]);
+			tickets.push_back(weights[slot]);
+		}
+	}
+	size_t capacity = tree.empty() ? 64 : tree.size() - 1;
+	while (2 * (pids.size() + 1) > capacity) {
+		capacity *= 2;
+	}
+	swap(slots, pids);
+	swap(weights, tickets);
+	// every node adds itself to its parent once, O(n)
+	tree.assign(capacity + 1, 0);
+	for (size_t i = 1; i <= capacity; i++) {
+		if (i <= slots.size()) {
+			tree[i] += weights[i - 1];
+		}
+		size_t parent = i + (i & -i);
+		if (parent <= capacity) {
+			tree[parent] += tree[i];
+		}
+	}
+}
+
+void TicketQueue::Push(int pid, long tickets) {
+	if (slots.size() + 1 >= tree.size()) {
+		Compact();
+	}
+	slots.push_back(pid);
+	weights.push_back(tickets);
+	for (size_t i = slots.size(); i < tree.size(); i += i & -i) {
+		tree[i] += tickets;
+	}
+	count++;
+	total += tickets;
+}
+
+int TicketQueue::PopHolder(long ticket) {
+	// descend to the last slot whose preceding tickets are at most ticket
+	size_t slot = 0;
+	for (size_t step = (tree.size() - 1) / 2; step; step /= 2) {
+		if (tree[slot + step] <= ticket) {
+			slot += step;
+			ticket -= tree[slot];
+		}
+	}
+	int pid = slots[slot];
+	long tickets = weights[slot];
+	for (size_t i = slot + 1; i < tree.size(); i += i & -i) {
+		tree[i] -= tickets;
+	}
+	slots[slot] = NO_PID;
+	count--;
+	total -= tickets;
+	return pid;
+}
+
+vector<int> TicketQueue::List() {
+	vector<int> pids;
+	for (int pid: slots) {
+		if (pid != NO_PID) {
+			pids.push_back(pid);
+		}
+	}
+	return pids;
+}
+
+/*
+ * LOTTERY Scheduler
+ */
+
+LOTTERY_scheduler::LOTTERY_scheduler(int quantum, function<long(long)> draw) :
+	Scheduler("LOTTERY", quantum),
+	draw(draw) {
+	traceSched("Initializing LOTTERY scheduler with quantum %d\n", quantum);
+}
+
+void LOTTERY_scheduler::AddProcess(int pid) {
+	readyQ.Push(pid, PROCESS_TABLE.tickets[pid]);
+}
+
+int LOTTERY_scheduler::GetNextProcess() {
+	if (readyQ.Size() == 0) {
+		return NO_PID;
+	}
+	long tickets = readyQ.Total();
+	int pid = readyQ.PopHolder(draw(tickets));
+	traceSched("Lottery of %ld tickets won by process %d\n", tickets, pid);
+	return pid;
+}
+
+void LOTTERY_scheduler::ShowReadyQueue() {
+	if (TRACE_SCHED > 2) {
+		traceSched("Show ReadyQ...\n");
+		for (int pid: readyQ.List()) {
+			traceSched("Process %d, Entry Time: %d, tickets: %d\n", pid, PROCESS_TABLE.state_time_stamp[pid], PROCESS_TABLE.tickets[pid]);
+		}
+	}
+
+	TRACE_OUT << "SCHED (" << readyQ.Size() << "):";
+	for (int pid: readyQ.List()) {
+		TRACE_OUT << "  " << pid << ":" << PROCESS_TABLE.state_time_stamp[pid];
+	}
+	TRACE_OUT << '\n';
+}
+
+/*
+ * STRIDE Scheduler
+ */
+
+STRIDE_scheduler::STRIDE_scheduler(int quantum) : Scheduler("STRIDE", quantum) {
+	traceSched("Initializing STRIDE scheduler with quantum %d\n", quantum);
+}
+
+void STRIDE_scheduler::AddProcess(int pid) {
+	ProcessTable &pt = PROCESS_TABLE;
+
+	// charge the cpu time used since the process was last queued
+	int used = pt.total_cpu_time[pid] - pt.rem_cpu_time[pid] - pt.charged_cpu_time[pid];
+	pt.vruntime[pid] += used * STRIDE1 / pt.tickets[pid];
+	pt.charged_cpu_time[pid] += used;
+
+	if (pt.rem_cpu_burst[pid] == 0) {
+		// new or woken up: no credit for the time it was not runnable
+		pt.vruntime[pid] = max(pt.vruntime[pid], global_pass);
+	}
+	traceSched("Add Process %d, used %d, tickets %d, pass %ld\n", pid, used, pt.tickets[pid], pt.vruntime[pid]);
+	readyQ.insert({pt.vruntime[pid], seq++, pid});
+}
+
+int STRIDE_scheduler::GetNextProcess() {
+	if (readyQ.empty()) {
+		return NO_PID;
+	}
+	auto first = readyQ.begin();
+	int pid = first->pid;
+	global_pass = max(global_pass, first->pass);
+	readyQ.erase(first);
+	return pid;
+}
+
+vector<int> STRIDE_scheduler::ReadyList() {
+	vector<int> pids;
+	for (auto &e: readyQ) {
+		pids.push_back(e.pid);
+	}
+	return pids;
+}
+
+void STRIDE_scheduler::SaveState(ostream &out) {
+	out << global_pass << " " << seq << " " << readyQ.size() << '\n';
+	for (auto &e: readyQ) {
+		out << e.pass << " " << e.seq << " " << e.pid << '\n';
+	}
+}
+
+void STRIDE_scheduler::LoadState(istream &in) {
+	long n = 0;
+	TreeEntry e;
+	readyQ.clear();
+	in >> global_pass >> seq >> n;
+	for (long i = 0; i < n && in >> e.pass >> e.seq >> e.pid; i++) {
+		readyQ.insert(e);
+	}
+}
+
+void STRIDE_scheduler::ShowReadyQueue() {
+	if (TRACE_SCHED > 2) {
+		traceSched("Show ReadyQ...\n");
+		for (auto &e: readyQ) {
+			traceSched("Process %d, Entry Time: %d, pass: %ld\n", e.pid, PROCESS_TABLE.state_time_stamp[e.pid], e.pass);
+		}
+	}
+
+	TRACE_OUT << "SCHED (" << readyQ.size() << "):";
+	for (auto &e: readyQ) {
+		TRACE_OUT << "  " << e.pid << ":" << PROCESS_TABLE.state_time_stamp[e.pid];
+	}
+	TRACE_OUT << '\n';
+}
+
+/*
+ * Real-time Schedulers: EDF and RM
+ */
+
+RealTime_scheduler::RealTime_scheduler(string type) : Scheduler(type, numeric_limits<int>::max()) {
+	traceSched("Initializing %s scheduler\n", &sched_type[0]);
+}
+
+long EDF_scheduler::Key(int pid) {
+	return PROCESS_TABLE.period[pid] ? PROCESS_TABLE.abs_deadline[pid] : NO_DEADLINE;
+}
+
+long RM_scheduler::Key(int pid) {
+	return PROCESS_TABLE.period[pid] ? PROCESS_TABLE.period[pid] : NO_DEADLINE;
+}
+
+void RealTime_scheduler::AddProcess(int pid) {
+	traceSched("Add Process %d, key %ld\n", pid, Key(pid));
+	readyQ.push_back({Key(pid), seq++, pid});
+	push_heap(readyQ.begin(), readyQ.end(), greater<HeapEntry>());
+}
+
+int RealTime_scheduler::GetNextProcess() {
+	if (readyQ.empty()) {
+		return NO_PID;
+	}
+	pop_heap(readyQ.begin(), readyQ.end(), greater<HeapEntry>());
+	int pid = readyQ.back().pid;
+	readyQ.pop_back();
+	return pid;
+}
+
+void RealTime_scheduler::ShowReadyQueue() {
+	// the heap is only partially ordered, show the queue in dispatch order
+	vector<HeapEntry> sorted(readyQ);
+	sort(sorted.begin(), sorted.end(), [](const HeapEntry &a, const HeapEntry &b) { return b > a; });
+	TRACE_OUT << "SCHED (" << sorted.size() << "):";
+	for (auto &e: sorted) {
+		TRACE_OUT << "  " << e.pid << ":" << PROCESS_TABLE.state_time_stamp[e.pid];
+	}
+	TRACE_OUT << '\n';
+}
+
+vector<int> RealTime_scheduler::ReadyList() {
+	// insertion order, re-adding keeps ties in the same order
+	vector<HeapEntry> sorted(readyQ);
+	sort(sorted.begin(), sorted.end(), [](const HeapEntry &a, const HeapEntry &b) { return a.seq < b.seq; });
+	vector<int> pids;
+	for (auto &e: sorted) {
+		pids.push_back(e.pid);
+	}
+	return pids;
+}
+
+bool RealTime_scheduler::TestPreempt(int pid, int current_time, int running_pid) {
+	traceSched("TestPreempt\n");
+	ProcessTable &pt = PROCESS_TABLE;
+	if (running_pid == NO_PID || !pt.pending_evt[running_pid]) {
+		traceSched("No current running process or pending event\n");
+		return false;
+	}
+
+	Event *pending_evt = pt.pending_evt[running_pid];
+	pt.time_to_pending_evt[running_pid] = pending_evt->time_stamp - current_time;
+	bool cond1 = Key(pid) < Key(running_pid);
+	bool cond2 = pending_evt->time_stamp > current_time;
+	if (SHOW_PRIO_PREEMPT) {
+		TRACE_OUT << "    --> Preempt Cond1=" << cond1 << " Cond2=" << cond2 << " (" << pt.time_to_pending_evt[running_pid]  << ") --> ";
+		if (cond1 && cond2) {
+			TRACE_OUT << "YES" << '\n';
+		} else {
+			TRACE_OUT << "NO" << '\n';
+		}
+	}
+	return cond1 && cond2;
+}
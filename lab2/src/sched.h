@@ -19,11 +19,14 @@
 
 #include <string>
 #include <deque>
-#include <list>
 #include <vector>
+#include <set>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <iosfwd>
 
 extern bool SHOW_SCHED_READY_QUEUE;
-extern int EVENT_COUNTER;
 extern bool SHOW_EVENT_QUEUE;
 extern bool SHOW_PRIO_PREEMPT;
 typedef enum { 
@@ -43,48 +46,151 @@ typedef enum {
 const std::string PROCESS_STATE_TO_STR[] {"CREATED", "READY", "RUNNG", "BLOCK"};
 const std::string TRANSITION_TO_STR[] {"READY", "RUNNG", "PREEMPT", "BLOCK"};
 
+const int NO_PID = -1;
+
 struct Event;
-struct Process {
-	const int pid;
-	const int arrival_time;
-	const int total_cpu_time;
-	const int cpu_burst;
-	const int io_burst;
-	const int static_prio;
-
-	Event *pending_evt = nullptr;
-	int time_to_pending_evt = 0;
-	int dynamic_prio;
-	int state_time_stamp;
-	int rem_cpu_time;
-	int rem_cpu_burst = 0; // unused cpu_burst due to preemption
-	int wait_time = 0; // time in ready state	
-	int io_time = 0; // time performing IO
-	int finish_time = 0;
-	Process(int pid, int at, int tc, int cb, int io, int prio); 
+/*
+ * Process table: a struct of arrays indexed by pid, so the fields touched on
+ * every event (rem_cpu_time, dynamic_prio, state_time_stamp) are dense arrays
+ * of their own. Events and schedulers refer to processes by pid.
+ */
+struct ProcessTable {
+	// input
+	std::vector<int> arrival_time;
+	std::vector<int> total_cpu_time;
+	std::vector<int> cpu_burst;
+	std::vector<int> io_burst;
+	std::vector<int> static_prio;
+	std::vector<uint64_t> cpu_burst_mod; // FastModReciprocal() of cpu_burst
+	std::vector<uint64_t> io_burst_mod;
+
+	// hot state
+	std::vector<int> rem_cpu_time;
+	std::vector<int> dynamic_prio;
+	std::vector<int> state_time_stamp;
+
+	std::vector<int> rem_cpu_burst; // unused cpu_burst due to preemption
+	std::vector<int> cpu; // cpu the process last ran on
+	std::vector<Event*> pending_evt; // DES::GetPendingEventByPID(), valid until the queue changes
+	std::vector<int> time_to_pending_evt;
+	std::vector<long> vruntime; // CFS virtual runtime, STRIDE pass
+	std::vector<int> charged_cpu_time; // cpu time already accounted by CFS / MLFQ
+	std::vector<int> mlfq_level; // MLFQ: levels below the top queue
+	std::vector<int> level_cpu_time; // MLFQ: cpu time used at that level
+	std::vector<int> boost_epoch; // MLFQ: boost period the level was set in
+	std::vector<int> tickets; // LOTTERY / STRIDE share
+	std::vector<double> share_clock_start; // share clock when last runnable
+	std::vector<int> migrated; // -H: 1 once the process left for another host
+	std::vector<int> period; // EDF / RM, 0: no deadline
+	std::vector<int> deadline; // relative to the release of a job
+	std::vector<int> abs_deadline; // of the current job
+
+	// statistics
+	std::vector<int> wait_time; // time in ready state
+	std::vector<int> io_time; // time performing IO
+	std::vector<int> finish_time;
+	std::vector<double> entitled_cpu_time; // fair share while runnable
+
+	// tickets 0: derived from prio, deadline 0: the period
+	int Add(int at, int tc, int cb, int io, int prio, int tickets = 0, int period = 0, int deadline = 0);
+	int Size() const { return arrival_time.size(); }
 };
 
+extern ProcessTable PROCESS_TABLE;
+
+/*
+ * Events are 16 byte values, copied in and out of the DES queue, never
+ * allocated one by one. seq is the insertion order, it keeps events with the
+ * same time stamp first in, first out.
+ */
 struct Event {
-	const int eid;
-	Process *process = nullptr;
-	const int time_stamp;
-	const ProcessState old_state;
-	const ProcessState new_state;
-	const Transition transition;
-	Event(Process *proc, int ts, ProcessState os, ProcessState ns, Transition t);	
+	int32_t time_stamp;
+	int32_t pid;
+	uint32_t seq;
+	uint8_t old_state : 2;
+	uint8_t new_state : 2;
+	uint8_t transition : 2;
+	Event() = default;
+	Event(int pid, int ts, ProcessState os, ProcessState ns, Transition t);	
 };
 
+static_assert(sizeof(Event) <= 16, "packed event record");
+
+/*
+ * Event queue: the input's arrivals, sorted upfront and consumed in order,
+ * ahead of a binary min-heap on (time stamp, seq) for all later events. A
+ * process has at most one pending event, so its pid is the handle of that
+ * event: heap_pos maps it to the event's slot for GetPendingEventByPID() and
+ * RemoveEvent().
+ */
 class DES {
+private:
+	enum EventSource { NO_EVENT, STREAMED_ARRIVAL, INPUT_ARRIVAL, QUEUED_EVENT };
+	std::vector<Event> arrivals;
+	size_t next_arrival = 0;
+	std::vector<Event> heap;
+	std::vector<int> heap_pos; // by pid, -1: no event queued
+	uint32_t next_seq = 0;
+	EventSource NextSource() const;
+	bool Before(const Event &a, const Event &b) const {
+		return a.time_stamp < b.time_stamp || (a.time_stamp == b.time_stamp && a.seq < b.seq);
+	}
+	bool HeapBefore(const Event &a, const Event &b) const; // Before(), counted
+	void Place(int pos, const Event &evt);
+	void SiftUp(int pos);
+	void SiftDown(int pos);
+	void Renumber();
 public:
-	std::list<Event*> eventQ;
-	DES(std::vector<Process> &processes); 
-	void PutEvent(Event *evt);
-	Event* GetEvent();
-	void RemoveEvent(int eid);
+	// next arrival when the input is streamed (-l), it goes ahead of queued
+	// events with the same time stamp, as if all arrivals were queued upfront
+	Event arrival;
+	bool has_arrival = false;
+	DES() = default; // empty queue, filled by a checkpoint restore
+	DES(ProcessTable &procs); 
+	void PutEvent(Event evt);
+	void PutArrival(const Event &evt);
+	bool GetEvent(Event &evt); // false: no events left
+	void RemoveEvent(int pid);
 	void ShowEventQ();
 	void TraceEventQ();	
 	int GetNextEventTime();
 	Event* GetPendingEventByPID(int pid);
+	std::vector<Event> QueuedEvents() const; // in queue order
+};
+
+/*
+ * I/O device (-d): serves one request at a time, the others wait in its
+ * queue, FIFO or by static priority (higher first, FIFO among equals).
+ */
+struct IORequest {
+	int key; // 0 (FIFO) or -static_prio
+	long seq;
+	int pid;
+	int io_burst;
+	int enqueue_time;
+	bool operator<(const IORequest &other) const {
+		return key != other.key ? key < other.key : seq < other.seq;
+	}
+};
+
+class IODevice {
+public:
+	const bool priority;
+	int current = NO_PID; // process being served
+	std::set<IORequest> queue;
+	long seq = 0;
+	// statistics
+	long busy_time = 0;
+	long requests = 0;
+	long queue_delay = 0; // sum of the time requests waited
+	int max_queue = 0;
+	IODevice(bool priority) : priority(priority) {}
+	bool Busy() { return current != NO_PID; }
+	int Outstanding() { return Busy() + queue.size(); }
+	void Enqueue(int pid, int io_burst, int now);
+	IORequest Dequeue();
+	void Save(std::ostream &out);
+	void Load(std::istream &in);
 };
 
 /*
@@ -96,25 +202,37 @@ public:
 	int quantum = 10 * 1000;
 	Scheduler(std::string type);
 	Scheduler(std::string type, int quantum);
-	virtual void AddProcess(Process *p) = 0;
-	virtual Process* GetNextProcess() = 0;
+	virtual void AddProcess(int pid) = 0;
+	virtual int GetNextProcess() = 0; // NO_PID when nothing is ready
 	virtual void ShowReadyQueue() = 0;
-	virtual bool TestPreempt(Process *proc, int current_time, Process *curr_running_proc) = 0;
+	virtual bool TestPreempt(int pid, int current_time, int running_pid) = 0;
+	virtual int ReadyCount() = 0;
+	// time slice for the process about to run
+	virtual int Quantum(int pid) { return quantum; }
+	// ready pids in an order AddProcess() turns back into an equivalent queue
+	virtual std::vector<int> ReadyList() = 0;
+	// checkpoints: exact queue state, only restored into the same scheduler
+	virtual void SaveState(std::ostream &out) {}
+	virtual void LoadState(std::istream &in) {}
+	// scheduler specific lines after the final statistics
+	virtual void ShowStatistics(const std::string &prefix) {}
 	virtual ~Scheduler() = default;
 };
 
 /*
  * FCFS Scheduler / Round Robin (FCFS + preemption) Scheduler
  */
-class FCFS_scheduler: public Scheduler {
+class FCFS_scheduler final: public Scheduler {
 private:
-	std::deque<Process*> readyQ;
+	std::deque<int> readyQ;
 public:
 	FCFS_scheduler();
 	FCFS_scheduler(std::string type, int quantum);
-	void AddProcess(Process *p);
-	Process* GetNextProcess();
-	bool TestPreempt(Process *proc, int current_time, Process *curr_running_proc) { return false; }
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid) { return false; }
+	int ReadyCount() { return readyQ.size(); }
+	std::vector<int> ReadyList() { return std::vector<int>(readyQ.begin(), readyQ.end()); }
 	void ShowReadyQueue();
 };
 
@@ -122,55 +240,317 @@ public:
  * LCFS Scheduler
  */
 
-class LCFS_scheduler: public Scheduler {
+class LCFS_scheduler final: public Scheduler {
 private:
-	std::deque<Process*> readyQ;
+	std::deque<int> readyQ;
 public:
 	LCFS_scheduler();
-	void AddProcess(Process *p);
-	Process* GetNextProcess();
-	bool TestPreempt(Process *proc, int current_time, Process *curr_running_proc) { return false; }
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid) { return false; }
+	int ReadyCount() { return readyQ.size(); }
+	std::vector<int> ReadyList() { return std::vector<int>(readyQ.begin(), readyQ.end()); }
 	void ShowReadyQueue();
 };
 
 /*
- * SRTF Scheduler
+ * SRTF Scheduler / PSRTF (Preemptive SRTF) Scheduler
  */
 
-class SRTF_scheduler: public Scheduler {
+class SRTF_scheduler final: public Scheduler {
 private:
-	std::list<Process*> readyQ;
+	// min-heap on (remaining cpu time, insertion order), ties keep FIFO order
+	struct HeapEntry {
+		int rem_cpu_time;
+		long seq;
+		int pid;
+		bool operator>(const HeapEntry &other) const {
+			return rem_cpu_time != other.rem_cpu_time ? rem_cpu_time > other.rem_cpu_time : seq > other.seq;
+		}
+	};
+	std::vector<HeapEntry> readyQ;
+	long seq = 0;
 public:
+	const bool srtf_preempt;
 	SRTF_scheduler();
-	void AddProcess(Process *p);
-	Process* GetNextProcess();
-	bool TestPreempt(Process *proc, int current_time, Process *curr_running_proc) { return false; }
+	SRTF_scheduler(bool srtf_preempt);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid);
+	int ReadyCount() { return readyQ.size(); }
+	std::vector<int> ReadyList();
 	void ShowReadyQueue();
 };
 
+/*
+ * Multi-level queue (higher level = higher priority)
+ * A two-level bitmap of the non-empty levels makes finding the highest
+ * non-empty level two find-first-set operations for up to 4096 levels.
+ */
+
+const int MLQUEUE_MAX_LEVELS = 64 * 64;
+
+class MLQueue {
+private:
+	std::vector<std::deque<int>> levels;
+	std::vector<uint64_t> bitmap; // bit i of word w set: level w * 64 + i is non-empty
+	uint64_t summary = 0; // bit w set: bitmap[w] != 0
+	int count = 0;
+public:
+	MLQueue(int nlevels);
+	void Push(int level, int pid);
+	int PopHighest();
+	int HighestLevel();
+	bool Empty() { return count == 0; }
+	int Size() { return count; }
+	int Levels() { return levels.size(); }
+	std::deque<int>& Level(int level) { return levels[level]; }
+	std::deque<int> TakeLevel(int level); // empties the level
+};
+
 /*
  * PRIO (Priority) / PREPRIO (Preemption Priority) Scheduler
  */
 
-class PRIO_scheduler: public Scheduler {
+class PRIO_scheduler final: public Scheduler {
 private:
-	std::vector<std::deque<Process*>> activeQ;
-    std::vector<std::deque<Process*>> expiredQ;
-	void PrintMLQueue(std::vector<std::deque<Process*>> &ml_queue);
-	bool IsEmptyQueue_(std::vector<std::deque<Process*>> &Q); 
-	void TraceQueue(std::vector<std::deque<Process*>> &ml_queue);
+	MLQueue activeQ;
+	MLQueue expiredQ;
+	void PrintMLQueue(MLQueue &ml_queue);
+	void TraceQueue(MLQueue &ml_queue);
+	void SaveQueue(std::ostream &out, MLQueue &ml_queue);
+	void LoadQueue(std::istream &in, MLQueue &ml_queue);
 public:
 	const int maxprio;
 	const bool priority_preempt;
 	PRIO_scheduler(int quantum, int maxprio);
 	PRIO_scheduler(int quantum, int maxprio, bool priority_preempt);
-	void AddProcess(Process *p);
-	Process* GetNextProcess();
-	bool TestPreempt(Process *proc, int current_time, Process *curr_running_proc);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid);
+	int ReadyCount();
+	std::vector<int> ReadyList();
+	void SaveState(std::ostream &out);
+	void LoadState(std::istream &in);
+	void ShowReadyQueue();
+};
+
+/*
+ * CFS (Completely Fair Scheduler)
+ * Ready processes sit in a red-black tree (std::set) ordered by virtual
+ * runtime: the cpu time they received, scaled down by their weight.
+ * The weight comes from static_prio through the kernel's nice-to-weight
+ * table (static_prio 1 is nice 0). Instead of a fixed quantum a dispatch
+ * gets its weighted share of the target latency, but at least
+ * min_granularity.
+ */
+
+const int CFS_DEFAULT_LATENCY = 24;
+const int CFS_DEFAULT_MIN_GRANULARITY = 3;
+const int CFS_NICE_0_WEIGHT = 1024;
+const int CFS_VRUNTIME_SHIFT = 10; // vruntime is kept in 1/1024 time units
+
+class CFS_scheduler final: public Scheduler {
+private:
+	struct TreeEntry {
+		long vruntime;
+		long seq;
+		int pid;
+		bool operator<(const TreeEntry &other) const {
+			return vruntime != other.vruntime ? vruntime < other.vruntime : seq < other.seq;
+		}
+	};
+	std::set<TreeEntry> readyQ;
+	long seq = 0;
+	long min_vruntime = 0;
+	long ready_weight = 0; // sum of the weights in readyQ
+	int Weight(int pid);
+public:
+	const int target_latency;
+	const int min_granularity;
+	CFS_scheduler(int target_latency, int min_granularity);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid) { return false; }
+	int ReadyCount() { return readyQ.size(); }
+	int Quantum(int pid);
+	std::vector<int> ReadyList();
+	void SaveState(std::ostream &out);
+	void LoadState(std::istream &in);
 	void ShowReadyQueue();
 };
 
+/*
+ * MLFQ (Multi-level Feedback Queue) Scheduler
+ * New processes start in the top queue, whose quantum doubles at every level
+ * down. A process that has used up the quantum of its level, over one or
+ * several bursts, is demoted one level. Every boost period all processes go
+ * back to the top queue: the queued ones move ahead of it as whole level
+ * queues, and every level is reset lazily through the boost epoch, when the
+ * process is queued or dispatched next.
+ * A process arriving in a higher queue preempts the running one.
+ */
 
+const int MLFQ_MAX_LEVELS = 16;
+const int MLFQ_DEFAULT_BOOST_QUANTA = 50; // boost period in top-level quanta
+
+// the quantum of the bottom level, quantum << (levels - 1), is an int
+inline bool MLFQQuantumFits(int quantum, int levels) {
+	return ((long)quantum << (levels - 1)) <= std::numeric_limits<int>::max();
+}
+
+class MLFQ_scheduler final: public Scheduler {
+private:
+	MLQueue readyQ; // queue index levels - 1 is the top level
+	std::deque<std::deque<int>> boosted; // queued at a boost, ahead of the top level
+	int boosted_count = 0;
+	int boost_period_count = 0; // boost periods started so far
+	std::vector<long> dispatches; // per level
+	std::vector<long> demotions; // per level, demotions out of the level
+	long boosts = 0;
+	int LevelQuantum(int level) { return quantum << level; } // fits an int, see MLFQQuantumFits()
+	void Boost(int epoch);
+	std::vector<int> LevelList(int level);
+public:
+	const int levels;
+	const int boost_period;
+	MLFQ_scheduler(int quantum, int levels, int boost_period);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid);
+	int ReadyCount() { return readyQ.Size() + boosted_count; }
+	int Quantum(int pid);
+	std::vector<int> ReadyList();
+	void SaveState(std::ostream &out);
+	void LoadState(std::istream &in);
+	void ShowReadyQueue();
+	void ShowStatistics(const std::string &prefix);
+};
+
+/*
+ * LOTTERY / STRIDE proportional-share Schedulers
+ * Each process holds tickets, given in the input or TICKETS_PER_PRIO per
+ * static priority level, and receives cpu time in proportion to them.
+ * LOTTERY draws the winning ticket from the random number file. STRIDE runs
+ * the process with the lowest pass; a pass advances by the cpu time used
+ * times STRIDE1 / tickets, and a new or woken process starts no lower than
+ * the pass of the last dispatched one.
+ */
+
+const int TICKETS_PER_PRIO = 100;
+const long STRIDE1 = 1 << 20;
+// int tickets of at most 2^31 ready processes stay below
+const long LOTTERY_MAX_TICKETS = 1L << 62;
+
+/*
+ * Ticket queue of LOTTERY: the ready processes in queue order, each in a
+ * slot of a Fenwick tree over their tickets, so the holder of a ticket is
+ * found and removed in O(log n). Removed slots stay empty until the slots run
+ * out and the queue compacts.
+ */
+class TicketQueue {
+private:
+	std::vector<int> slots; // pid by slot, NO_PID once removed
+	std::vector<long> weights; // tickets by slot
+	std::vector<long> tree; // tree[i]: tickets of slots i - (i & -i) .. i - 1
+	int count = 0;
+	long total = 0;
+	void Compact();
+public:
+	void Push(int pid, long tickets);
+	int PopHolder(long ticket); // ticket in 0..Total() - 1, in queue order
+	int Size() { return count; }
+	long Total() { return total; }
+	std::vector<int> List();
+};
+
+class LOTTERY_scheduler final: public Scheduler {
+private:
+	TicketQueue readyQ;
+	std::function<long(long)> draw; // uniform random number in 0..n-1
+public:
+	LOTTERY_scheduler(int quantum, std::function<long(long)> draw);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid) { return false; }
+	int ReadyCount() { return readyQ.Size(); }
+	std::vector<int> ReadyList() { return readyQ.List(); }
+	void ShowReadyQueue();
+};
+
+class STRIDE_scheduler final: public Scheduler {
+private:
+	struct TreeEntry {
+		long pass;
+		long seq;
+		int pid;
+		bool operator<(const TreeEntry &other) const {
+			return pass != other.pass ? pass < other.pass : seq < other.seq;
+		}
+	};
+	std::set<TreeEntry> readyQ;
+	long seq = 0;
+	long global_pass = 0; // pass of the last dispatched process
+public:
+	STRIDE_scheduler(int quantum);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid) { return false; }
+	int ReadyCount() { return readyQ.size(); }
+	std::vector<int> ReadyList();
+	void SaveState(std::ostream &out);
+	void LoadState(std::istream &in);
+	void ShowReadyQueue();
+};
+
+/*
+ * Real-time Schedulers: EDF and RM
+ * Every cpu burst of a process is a job, released when the process becomes
+ * ready after its arrival or an IO, due its relative deadline later.
+ * The ready process with the smallest key runs and preempts a running one
+ * with a larger key: EDF by the absolute deadline of the job, RM by the
+ * period. Processes without a period have no deadline and come last.
+ * Bursts are not time sliced.
+ */
+class RealTime_scheduler: public Scheduler {
+protected:
+	// min-heap on (key, insertion order), ties keep FIFO order
+	struct HeapEntry {
+		long key;
+		long seq;
+		int pid;
+		bool operator>(const HeapEntry &other) const {
+			return key != other.key ? key > other.key : seq > other.seq;
+		}
+	};
+	std::vector<HeapEntry> readyQ;
+	long seq = 0;
+	virtual long Key(int pid) = 0;
+public:
+	RealTime_scheduler(std::string type);
+	void AddProcess(int pid);
+	int GetNextProcess();
+	bool TestPreempt(int pid, int current_time, int running_pid);
+	int ReadyCount() { return readyQ.size(); }
+	std::vector<int> ReadyList();
+	void ShowReadyQueue();
+};
+
+const long NO_DEADLINE = 1L << 62; // key of the processes without a period
+
+class EDF_scheduler final: public RealTime_scheduler {
+protected:
+	long Key(int pid);
+public:
+	EDF_scheduler() : RealTime_scheduler("EDF") {}
+};
+
+class RM_scheduler final: public RealTime_scheduler {
+protected:
+	long Key(int pid);
+public:
+	RM_scheduler() : RealTime_scheduler("RM") {}
+};
 
 #endif	
 
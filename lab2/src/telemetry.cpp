@@ -0,0 +1,140 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+Telemetry::Telemetry(const string &path, int interval_ms, int num_cpus)
+	: path(path), interval_ms(interval_ms), num_cpus(min(num_cpus, TELEMETRY_MAX_CPUS)) {
+	for (int cpu = 0; cpu < TELEMETRY_MAX_CPUS; cpu++) {
+		ready[cpu].store(0, memory_order_relaxed);
+		running[cpu].store(-1, memory_order_relaxed);
+	}
+}
+
+Telemetry::~Telemetry() {
+	this->Stop();
+}
+
+bool Telemetry::Start() {
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	// a stale socket of an earlier run, never any other file
+	struct stat st;
+	if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+		unlink(path.c_str());
+	}
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0
+		|| pipe(wake_fds) != 0) {
+		return false;
+	}
+	fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+	exporter = thread(&Telemetry::ExporterLoop, this);
+	return true;
+}
+
+void Telemetry::Stop() {
+	if (!exporter.joinable()) {
+		return;
+	}
+	char c = 0;
+	if (write(wake_fds[1], &c, 1) != 1) {
+		perror("telemetry");
+	}
+	exporter.join();
+	for (int fd: clients) {
+		close(fd);
+	}
+	clients.clear();
+	close(listen_fd);
+	close(wake_fds[0]);
+	close(wake_fds[1]);
+	unlink(path.c_str());
+}
+
+// a consistent copy: retried while the simulation is in the middle of an update
+void Telemetry::Read(TelemetrySnapshot &snap) {
+	unsigned before, after;
+	do {
+		before = seq.load(memory_order_acquire);
+		snap.time = time.load(memory_order_relaxed);
+		snap.events = events.load(memory_order_relaxed);
+		snap.cpu_busy = cpu_busy.load(memory_order_relaxed);
+		snap.io_use = io_use.load(memory_order_relaxed);
+		for (int cpu = 0; cpu < num_cpus; cpu++) {
+			snap.ready[cpu] = ready[cpu].load(memory_order_relaxed);
+			snap.running[cpu] = running[cpu].load(memory_order_relaxed);
+		}
+		atomic_thread_fence(memory_order_acquire);
+		after = seq.load(memory_order_relaxed);
+	} while ((before & 1) || before != after);
+}
+
+void Telemetry::Send(const TelemetrySnapshot &snap, double events_per_sec) {
+	char line[64 + 24 * TELEMETRY_MAX_CPUS];
+	int n = snprintf(line, sizeof(line), "time=%ld events=%ld events_per_sec=%.0f cpu_util=%.2f io_util=%.2f ready=",
+					 snap.time, snap.events, events_per_sec,
+					 snap.time ? 100.0 * snap.cpu_busy / snap.time / num_cpus : 0.0,
+					 snap.time ? 100.0 * snap.io_use / snap.time : 0.0);
+	for (int cpu = 0; cpu < num_cpus; cpu++) {
+		n += snprintf(line + n, sizeof(line) - n, cpu ? ",%d" : "%d", snap.ready[cpu]);
+	}
+	n += snprintf(line + n, sizeof(line) - n, " running=");
+	for (int cpu = 0; cpu < num_cpus; cpu++) {
+		n += snprintf(line + n, sizeof(line) - n, cpu ? ",%d" : "%d", snap.running[cpu]);
+	}
+	n += snprintf(line + n, sizeof(line) - n, "\n");
+
+	// a client that does not keep up or went away is dropped
+	auto gone = [&](int fd) {
+		if (send(fd, line, n, MSG_NOSIGNAL | MSG_DONTWAIT) == n) {
+			return false;
+		}
+		close(fd);
+		return true;
+	};
+	clients.erase(remove_if(clients.begin(), clients.end(), gone), clients.end());
+}
+
+void Telemetry::ExporterLoop() {
+	using clock = chrono::steady_clock;
+	TelemetrySnapshot snap;
+	long last_events = 0;
+	clock::time_point last = clock::now();
+	clock::time_point next = last + chrono::milliseconds(interval_ms);
+	bool stop = false;
+	while (!stop) {
+		int timeout = max(0L, (long)chrono::duration_cast<chrono::milliseconds>(next - clock::now()).count());
+		pollfd fds[2] = {{listen_fd, POLLIN, 0}, {wake_fds[0], POLLIN, 0}};
+		poll(fds, 2, timeout);
+		if (fds[0].revents & POLLIN) {
+			int fd;
+			while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+				clients.push_back(fd);
+			}
+		}
+		stop = fds[1].revents & POLLIN;
+		clock::time_point now = clock::now();
+		if (now < next && !stop) {
+			continue;
+		}
+		Read(snap);
+		double seconds = chrono::duration<double>(now - last).count();
+		Send(snap, seconds > 0 ? (snap.events - last_events) / seconds : 0);
+		last_events = snap.events;
+		last = now;
+		next = now + chrono::milliseconds(interval_ms);
+	}
+}
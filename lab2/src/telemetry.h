@@ -0,0 +1,75 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+const int TELEMETRY_MAX_CPUS = 64; // cpus beyond are not reported
+
+/*
+ * Live telemetry (-u): the simulation publishes its counters into a seqlock'd
+ * block once per time step, relaxed stores only, no locks and no system
+ * calls. An exporter thread takes a consistent copy every interval and sends
+ * it as one text line to every client of a local UNIX domain socket:
+ *   time=<t> events=<n> events_per_sec=<r> cpu_util=<%> io_util=<%> ready=<q0,q1,..> running=<pid0,pid1,..>
+ * cpu and io time are counted when a burst starts, as in the SUM line.
+ * One thread publishes, one thread exports.
+ */
+struct TelemetrySnapshot {
+	long time;
+	long events;
+	long cpu_busy;
+	long io_use;
+	int ready[TELEMETRY_MAX_CPUS];
+	int running[TELEMETRY_MAX_CPUS];
+};
+
+class Telemetry {
+private:
+	const std::string path;
+	const int interval_ms;
+	const int num_cpus;
+	std::atomic<unsigned> seq{0}; // odd while an update is in progress
+	std::atomic<long> time{0};
+	std::atomic<long> events{0};
+	std::atomic<long> cpu_busy{0};
+	std::atomic<long> io_use{0};
+	std::atomic<int> ready[TELEMETRY_MAX_CPUS];
+	std::atomic<int> running[TELEMETRY_MAX_CPUS];
+	int listen_fd = -1;
+	int wake_fds[2] = {-1, -1}; // Stop() wakes the exporter up
+	std::vector<int> clients;
+	std::thread exporter;
+	void Read(TelemetrySnapshot &snap);
+	void Send(const TelemetrySnapshot &snap, double events_per_sec);
+	void ExporterLoop();
+public:
+	Telemetry(const std::string &path, int interval_ms, int num_cpus);
+	~Telemetry();
+	bool Start(); // false when the socket can not be set up
+	void Stop(); // sends a last snapshot and closes the socket
+
+	// publishing, simulation thread only: BeginUpdate(), the setters, EndUpdate()
+	void BeginUpdate() {
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	void SetCounters(long t, long n, long busy, long io) {
+		time.store(t, std::memory_order_relaxed);
+		events.store(n, std::memory_order_relaxed);
+		cpu_busy.store(busy, std::memory_order_relaxed);
+		io_use.store(io, std::memory_order_relaxed);
+	}
+	void SetCPU(int cpu, int ready_count, int running_pid) {
+		ready[cpu].store(ready_count, std::memory_order_relaxed);
+		running[cpu].store(running_pid, std::memory_order_relaxed);
+	}
+	void EndUpdate() {
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+	int ReportedCPUs() { return num_cpus; }
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Minimal client for the simulator's live telemetry (-u): prints the
+ * snapshot lines of a running simulation until it finishes.
+ *
+ * usage: telemetry_client <socket>
+ */
+#include <iostream>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		cerr << "usage: " << argv[0] << " <socket>" << endl;
+		return 1;
+	}
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+		cerr << "Can not connect to <" << argv[1] << ">" << endl;
+		return 1;
+	}
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		cout.write(buf, n);
+		cout.flush();
+	}
+	close(fd);
+	return 0;
+}
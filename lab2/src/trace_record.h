@@ -0,0 +1,50 @@
+#ifndef TRACE_RECORD_H
+#define TRACE_RECORD_H
+
+#include <cstdint>
+
+/*
+ * Binary event trace (-r <file>), read back by the replay tool.
+ * A TraceFileHeader followed by fixed-size TraceRecords in dispatch order.
+ * Every process gets a REC_PROCESS record (its input line) right before its
+ * arrival is dispatched, then one REC_EVENT record per dispatched event with
+ * the values the -v line of that event prints.
+ * Fields are written in host byte order.
+ */
+
+const char TRACE_FILE_MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'T', 'R', 'C'};
+const int32_t TRACE_FILE_VERSION = 1;
+
+struct TraceFileHeader {
+	char magic[8];
+	int32_t version;
+	int32_t num_cpus;
+	int32_t quantum;
+	int32_t maxprio;
+	char sched_type[16];
+};
+
+typedef enum {
+	REC_EVENT,
+	REC_PROCESS
+} RecordKind;
+
+struct TraceRecord {
+	int32_t time_stamp; // REC_PROCESS: arrival time
+	int32_t pid;
+	int32_t time_in_prev_state;
+	int32_t cpu_burst; // RUNNG: burst being run, PREEMPT: unused burst. REC_PROCESS: max cpu burst
+	int32_t io_burst; // BLOCK: io burst. REC_PROCESS: max io burst
+	int32_t rem; // remaining cpu time as printed by -v. REC_PROCESS: total cpu time
+	int16_t prio; // dynamic prio. REC_PROCESS: static prio
+	int16_t cpu;
+	uint8_t kind;
+	uint8_t transition;
+	uint8_t old_state;
+	uint8_t new_state;
+};
+
+static_assert(sizeof(TraceFileHeader) == 40, "trace file header layout");
+static_assert(sizeof(TraceRecord) == 32, "trace record layout");
+
+#endif
@@ -0,0 +1,120 @@
+#include "trace_sink.h"
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+using namespace std;
+
+TraceSink TRACE_OUT(STDOUT_FILENO, 1 << 20);
+
+TraceSink::TraceSink(int fd, size_t capacity) : fd(fd), buf(capacity), mask(capacity - 1) {
+}
+
+TraceSink::~TraceSink() {
+	this->Flush();
+	if (async) {
+		{
+			lock_guard<mutex> lk(lock);
+			stop = true;
+		}
+		cond.notify_all();
+		writer.join();
+	}
+}
+
+void TraceSink::StartWriter() {
+	async = true;
+	writer = thread(&TraceSink::WriterLoop, this);
+}
+
+// write buf[from, to) (positions taken modulo the buffer size) to fd
+void TraceSink::WriteOut(size_t from, size_t to) {
+	while (from < to) {
+		size_t start = from & mask;
+		size_t len = min(to - from, buf.size() - start);
+		ssize_t n = write(fd, &buf[start], len);
+		if (n <= 0) {
+			return;
+		}
+		from += n;
+	}
+}
+
+void TraceSink::WriterLoop() {
+	unique_lock<mutex> lk(lock);
+	while (true) {
+		cond.wait_for(lk, chrono::milliseconds(10), [&] {
+			return stop || head.load() - tail.load() >= buf.size() / 2;
+		});
+		size_t h = head.load(memory_order_acquire);
+		size_t t = tail.load(memory_order_relaxed);
+		if (h != t) {
+			lk.unlock();
+			WriteOut(t, h);
+			lk.lock();
+			tail.store(h, memory_order_release);
+			cond.notify_all();
+		} else if (stop) {
+			break;
+		}
+	}
+}
+
+void TraceSink::MakeRoom(size_t n) {
+	if (buf.size() - (head.load(memory_order_relaxed) - tail.load(memory_order_acquire)) >= n) {
+		return;
+	}
+	if (!async) {
+		WriteOut(tail, head);
+		tail.store(head);
+		return;
+	}
+	unique_lock<mutex> lk(lock);
+	cond.notify_all();
+	cond.wait(lk, [&] { return buf.size() - (head.load() - tail.load()) >= n; });
+}
+
+void TraceSink::Append(const char *s, size_t n) {
+	while (n > 0) {
+		size_t len = min(n, buf.size());
+		MakeRoom(len);
+		size_t h = head.load(memory_order_relaxed);
+		size_t start = h & mask;
+		size_t first = min(len, buf.size() - start);
+		memcpy(&buf[start], s, first);
+		memcpy(&buf[0], s + first, len - first);
+		head.store(h + len, memory_order_release);
+		s += len;
+		n -= len;
+	}
+}
+
+void TraceSink::Flush() {
+	if (!async) {
+		WriteOut(tail, head);
+		tail.store(head);
+		return;
+	}
+	unique_lock<mutex> lk(lock);
+	cond.notify_all();
+	cond.wait(lk, [&] { return tail.load() == head.load(); });
+}
+
+TraceSink& TraceSink::operator<<(const char *s) {
+	Append(s, strlen(s));
+	return *this;
+}
+
+TraceSink& TraceSink::operator<<(long v) {
+	char digits[24];
+	char *p = digits + sizeof(digits);
+	unsigned long u = v < 0 ? -(unsigned long)v : v;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	if (v < 0) {
+		*--p = '-';
+	}
+	Append(p, digits + sizeof(digits) - p);
+	return *this;
+}
@@ -0,0 +1,50 @@
+#ifndef TRACE_SINK_H
+#define TRACE_SINK_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Output sink for the -v/-t/-e/-p traces.
+ * Text is formatted straight into a ring buffer (integers without iostream)
+ * and drained to the file descriptor in large writes, either when the buffer
+ * fills up or, after StartWriter(), by a background writer thread.
+ * One thread produces, one thread drains.
+ */
+class TraceSink {
+private:
+	const int fd;
+	std::vector<char> buf;
+	const size_t mask; // buffer size is a power of two
+	std::atomic<size_t> head{0}; // total bytes appended
+	std::atomic<size_t> tail{0}; // total bytes written to fd
+	std::thread writer;
+	std::mutex lock;
+	std::condition_variable cond;
+	bool async = false;
+	bool stop = false;
+	void WriteOut(size_t from, size_t to);
+	void MakeRoom(size_t n);
+	void WriterLoop();
+public:
+	TraceSink(int fd, size_t capacity);
+	~TraceSink();
+	void StartWriter();
+	void Append(const char *s, size_t n);
+	void Flush();
+
+	TraceSink& operator<<(const char *s);
+	TraceSink& operator<<(const std::string &s) { Append(s.data(), s.size()); return *this; }
+	TraceSink& operator<<(char c) { Append(&c, 1); return *this; }
+	TraceSink& operator<<(long v);
+	TraceSink& operator<<(int v) { return *this << (long)v; }
+	TraceSink& operator<<(unsigned long v) { return *this << (long)v; }
+};
+
+extern TraceSink TRACE_OUT;
+
+#endif
@@ -175,14 +175,21 @@ unsigned int ESCPager::SelectVictimFrame() {
  */
 
 RandGenerator::RandGenerator(string rfile_name) {
+	if (table.Map(rfile_name)) {
+		total = table.count;
+		randvals = table.values;
+		traceM("Mapped RandGenerator table with %d numbers\n", total);
+		return;
+	}
 	ifstream rfile(rfile_name);
 	if (rfile) {
 		rfile >> total;
 		traceM("Initializing RandGenerator with %d numbers\n", total);
 		int num;
 		while (rfile >> num) {
-			randvals.push_back(num);
+			owned.push_back(num);
 		}
+		randvals = owned.data();
 	} else {
 		cerr << "Not a valid random file <" << rfile_name << ">" << endl;
 		exit(1);
@@ -237,7 +244,11 @@ unsigned int RandGenerator::myrandom(unsigned int upper_bound) {
 		ofs = 0;
 	}
 	traceM("Rand Val: %d\n", randvals[ofs]);
-	return randvals[ofs] % upper_bound;
+	if (upper_bound != bound) {
+		bound = upper_bound;
+		reciprocal = FastModReciprocal(bound);
+	}
+	return FastMod(randvals[ofs], reciprocal, bound);
 }
 
 /*
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <deque>
 #include <fstream>
+#include <cstdint>
+#include "../../lab2/src/rand_table.h" // the binary random table format
 
 // TRACING
 #ifndef TRACE_MMU
@@ -208,11 +210,20 @@ public:
  */
 
 class RandGenerator {
+private:
+	vector<int> owned; // the numbers of a text rfile
+	RandTableMapping table; // binary random table written by lab2's randtab
+	// a % bound by two multiplications with the bound's precomputed
+	// reciprocal (FastMod); the pagers always draw with the same bound
+	unsigned int bound = 0;
+	uint64_t reciprocal = 0;
 public:
 	int total = 0;
 	int ofs = -1;
-	vector<int> randvals;
+	const int *randvals = nullptr;
 	RandGenerator(string rfile_name);
+	RandGenerator(const RandGenerator&) = delete; // owns the mapped table
+	RandGenerator& operator=(const RandGenerator&) = delete;
 	unsigned int myrandom(unsigned int upper_bound);
 };
 